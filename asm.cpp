@@ -9,8 +9,10 @@ Project 1
 #include <string>
 #include <vector>
 #include <fstream>
+#include <sstream>
 #include <bitset>
 #include <unordered_map>
+#include <numeric>
 
 using namespace std;
 
@@ -33,15 +35,19 @@ const int op_jal = 3;		// 011
 unordered_map<string, int> labels;
 
 /**
-	print_line(address, num)
+	print_line(address, num, source)
 	Print a line of machine code in the required format.
 	Parameters:
 		address = RAM address of the instructions
 		num = numeric value of machine instruction 
+		source = the instruction as written, printed as a comment unless it is ""
 */
-void print_machine_code(unsigned address, unsigned num) {
+void print_machine_code(unsigned address, unsigned num, const string &source) {
 	bitset<16> instruction_in_binary(num);
-	cout << "ram[" << address << "] = 16'b" << instruction_in_binary <<";"<<endl;
+	cout << "ram[" << address << "] = 16'b" << instruction_in_binary <<";";
+	if (source != "")
+		cout << "\t\t// " << source;
+	cout << endl;
 }
 
 // Takes in a string variable line and splits the string into elements
@@ -103,6 +109,38 @@ string convert_lower(const string &s) {
     return res;
 }
 
+// Takes in a 2D vector of strings, before labels are substituted or stripped.
+// Returns the source of each instruction, with the labels that point at it,
+// e.g. "loop: lw $2,myarray($1)", for the comments in the machine code.
+vector<string> source_comments(const vector<vector<string>>& everything) {
+	vector<string> result;
+	string pending = "";	// labels waiting for an instruction
+
+	for (size_t i = 0; i < everything.size(); i++) {
+		string operation = "";
+		vector<string> operands;
+		for (size_t j = 0; j < everything[i].size(); j++) {
+			const string &word = everything[i][j];
+			if (contains(word, ':'))
+				pending += word + " ";
+			else if (operation == "")
+				operation = word;
+			else
+				operands.push_back(word);
+		}
+		if (operation == "")
+			continue;
+
+		string comment = pending + operation + " ";
+		for (size_t j = 0; j < operands.size(); j++)
+			comment += (j ? "," : "") + operands[j];
+		result.push_back(comment);
+		pending = "";
+	}
+
+	return result;
+}
+
 // Takes in a 2D vector of strings and iterates through every element.
 // If a label is detected, stores the value of the label into our unordered map.
 // The value of the label is tracked by int pc.
@@ -145,7 +183,7 @@ void substitute_labels(vector<vector<string>>& everything) {
 
 			unordered_map<string, int>::const_iterator found = labels.find(convert_lower(word));
 			if (found != labels.end()) {
-				word = to_string(labels[word]) + reg;
+				word = to_string(found->second) + reg;
 			}
 			else
 				word = word + reg;
@@ -161,24 +199,20 @@ void substitute_labels(vector<vector<string>>& everything) {
 // Will become:
 // 		movi $1 10
 // 		jeq $1 $0 done
+// Several labels in a row, on one line or on consecutive lines, are all removed.
 void strip_labels(vector<vector<string>>& everything) {
-	vector<vector<string>>::iterator row = everything.begin();
+	vector<vector<string>> result;
 	for (size_t i = 0; i < everything.size(); i++) {
-
-		vector<string>::iterator col = everything[i].begin();
+		vector<string> row;
 		for (size_t j = 0; j < everything[i].size(); j++) {
-			
-			if (contains(everything[i][j], ':'))
-				everything[i].erase(col);
-
-			if (everything[i].size() == 0)	// If line is empty, remove the whole row.
-				everything.erase(row);
-
-			col++;
+			if (!contains(everything[i][j], ':'))
+				row.push_back(everything[i][j]);
 		}
 
-		row++;
+		if (row.size() > 0)	// If line is empty, remove the whole row.
+			result.push_back(row);
 	}
+	everything = result;
 }
 
 // Takes in a string representing a register and
@@ -388,6 +422,854 @@ vector<unsigned> program_to_int(const vector<vector<string>>& input) {
 	return result;
 }
 
+// Takes in a string and returns true if it is a decimal number, like an immediate
+bool is_number(const string &word) {
+	size_t start = (word.size() > 1 && word[0] == '-') ? 1 : 0;
+	if (word.size() == start)
+		return false;
+	for (size_t i = start; i < word.size(); i++) {
+		if (!isdigit(word[i]))
+			return false;
+	}
+	return true;
+}
+
+// Takes in a row of the program and returns its operation in lowercase,
+// or "" for a row of labels
+string row_operation(const vector<string>& row) {
+	for (const string &word : row) {
+		if (!contains(word, ':'))
+			return convert_lower(word);
+	}
+	return "";
+}
+
+// Takes in a row of the program and the address it starts at
+// Returns the number of words it takes: none for a row of labels, the count of
+// a .space, the padding up to the boundary of an .align, and one for the rest.
+// A count that isn't a positive number takes no words.
+size_t row_words(const vector<string>& row, size_t address) {
+	string operation = row_operation(row);
+	if (operation == "")
+		return 0;
+	if (operation == ".space" || operation == ".align") {
+		int count = is_number(row.back()) ? stoi(row.back()) : 0;
+		if (count <= 0)
+			return 0;
+		return (operation == ".space") ? count : (count - address % count) % count;
+	}
+	return 1;
+}
+
+// Takes in a 2D vector of strings and replaces each .space N and .align N with
+// the .fill 0 words it stands for, keeping its labels on the first word.
+// For example, at address 5:	buffer: .align 4
+// Will become:					buffer: .fill 0
+// 								.fill 0
+// 								.fill 0
+// Returns false, after printing why, if a count isn't a number of words.
+bool expand_directives(vector<vector<string>>& everything) {
+	vector<vector<string>> result;
+	size_t address = 0;
+	for (size_t i = 0; i < everything.size(); i++) {
+		vector<string> labels;
+		size_t j = 0;
+		while (j < everything[i].size() && contains(everything[i][j], ':'))
+			labels.push_back(everything[i][j++]);
+		string operation = row_operation(everything[i]);
+		if (operation != ".space" && operation != ".align") {
+			result.push_back(everything[i]);
+			address += row_words(everything[i], address);
+			continue;
+		}
+
+		if (everything[i].size() != j + 2 || !is_number(everything[i][j+1]) ||
+			stoi(everything[i][j+1]) < (operation == ".align" ? 1 : 0)) {
+			cerr << "Bad count in " << operation << " at address " << address << endl;
+			return false;
+		}
+		size_t words = row_words(everything[i], address);
+		if (words == 0 && labels.size() > 0)
+			result.push_back(labels);
+		for (size_t w = 0; w < words; w++) {
+			vector<string> row = (w == 0) ? labels : vector<string>();
+			row.push_back(".fill");
+			row.push_back("0");
+			result.push_back(row);
+		}
+		address += words;
+	}
+	everything = result;
+	return true;
+}
+
+/*
+	Optimizer (-O)
+
+	Works on the program before labels are resolved, so that removing instructions
+	only moves labels, and every jump, including the relative offset of jeq, is
+	resolved again afterwards. The passes thread jumps to jumps, remove code that
+	can't be reached, remove nops and jumps to the next instruction, and fold
+	constant movi/addi/arithmetic sequences within a basic block, dropping writes
+	that are overwritten before they are read.
+
+	Moving code changes addresses, so the optimizer leaves a program alone if it
+	jumps to a number instead of a label, takes the address of an instruction that
+	isn't .fill, reads or writes the program at a fixed address, or has an
+	immediate that doesn't fit in 7 bits. Labeled instructions are kept as entry
+	points, since jr and --entry can reach them. An instruction right after a j,
+	jr or halt with no label could only be an --entry of simcache, so -O refuses
+	such a program rather than remove it. Programs also reach their data
+	at computed addresses, so every .fill keeps its address, with zero words
+	filling the space the code before it gave up.
+*/
+
+// One line of the program for the optimizer: an instruction or .fill, with the
+// labels that point at it
+struct Line {
+	vector<string> labels;	// as written, with the colon
+	string op;				// in lowercase
+	vector<string> args;
+	size_t address;			// in the program as written
+	bool removed = false;
+};
+
+// Labels after the last instruction
+vector<string> tail_labels;
+
+// Takes in an operand and strips the ($reg) of a lw or sw address
+string address_part(const string &arg) {
+	return contains(arg, ')') ? arg.substr(0, arg.size()-4) : arg;
+}
+
+// Takes in an operand and returns the register of a lw or sw address, like "$2"
+string base_register(const string &arg) {
+	return arg.substr(arg.size()-3, 2);
+}
+
+// Takes in a 2D vector of strings holding the program as written
+// Returns its lines, with label-only lines attached to the next instruction
+vector<Line> build_lines(const vector<vector<string>>& everything) {
+	vector<Line> lines;
+	vector<string> pending;
+	for (size_t i = 0; i < everything.size(); i++) {
+		Line line;
+		for (size_t j = 0; j < everything[i].size(); j++) {
+			const string &word = everything[i][j];
+			if (contains(word, ':'))
+				pending.push_back(word);
+			else if (line.op == "")
+				line.op = convert_lower(word);
+			else
+				line.args.push_back(word);
+		}
+		if (line.op == "")
+			continue;
+		line.labels = pending;
+		line.address = lines.size();
+		pending.clear();
+		lines.push_back(line);
+	}
+	tail_labels = pending;
+	return lines;
+}
+
+// Takes in the lines and returns the index of the line each label points at,
+// or the number of lines for labels after the last one
+unordered_map<string, size_t> label_lines(const vector<Line>& lines) {
+	unordered_map<string, size_t> result;
+	for (size_t i = 0; i < lines.size(); i++) {
+		for (const string &label : lines[i].labels)
+			result[convert_lower(label.substr(0, label.size()-1))] = i;
+	}
+	for (const string &label : tail_labels)
+		result[convert_lower(label.substr(0, label.size()-1))] = lines.size();
+	return result;
+}
+
+// Takes in the lines and the index of one, and returns the index of the first
+// line at or after it that hasn't been removed
+size_t next_line(const vector<Line>& lines, size_t i) {
+	while (i < lines.size() && lines[i].removed)
+		i++;
+	return i;
+}
+
+// Takes in the lines and the index of one
+// Removes the line, moving its labels to the next line
+void remove_line(vector<Line>& lines, size_t i) {
+	lines[i].removed = true;
+	size_t next = next_line(lines, i);
+	vector<string> &to = (next < lines.size()) ? lines[next].labels : tail_labels;
+	to.insert(to.begin(), lines[i].labels.begin(), lines[i].labels.end());
+	lines[i].labels.clear();
+}
+
+// Takes in a line and returns the index of its jump target operand, or -1
+int target_arg(const Line &line) {
+	if (line.op == "j" || line.op == "jal")
+		return 0;
+	if (line.op == "jeq")
+		return 2;
+	return -1;
+}
+
+// Takes in a line and returns true if control doesn't always go on to the next line
+bool ends_block(const Line &line) {
+	return target_arg(line) >= 0 || line.op == "jr" || line.op == "halt";
+}
+
+// Takes in a line and returns the register it writes, or -1
+int written_register(const Line &line) {
+	if (line.op == "add" || line.op == "sub" || line.op == "or" || line.op == "and" || line.op == "slt" ||
+		line.op == "addi" || line.op == "slti" || line.op == "movi" || line.op == "lw")
+		return reg_to_int(line.args[0]);
+	if (line.op == "jal")
+		return 7;
+	return -1;
+}
+
+// Takes in a line and returns the registers it reads
+vector<int> read_registers(const Line &line) {
+	if (line.op == "add" || line.op == "sub" || line.op == "or" || line.op == "and" || line.op == "slt")
+		return {reg_to_int(line.args[1]), reg_to_int(line.args[2])};
+	if (line.op == "addi" || line.op == "slti" || line.op == "jr")
+		return {reg_to_int(line.args[line.op == "jr" ? 0 : 1])};
+	if (line.op == "lw")
+		return {reg_to_int(base_register(line.args[1]))};
+	if (line.op == "sw")
+		return {reg_to_int(line.args[0]), reg_to_int(base_register(line.args[1]))};
+	if (line.op == "jeq")
+		return {reg_to_int(line.args[0]), reg_to_int(line.args[1])};
+	return {};
+}
+
+// Takes in the lines
+// Returns false if moving them could change what the program does
+bool can_move(const vector<Line>& lines) {
+	unordered_map<string, size_t> where = label_lines(lines);
+	for (const Line &line : lines) {
+		int target = target_arg(line);
+		for (size_t j = 0; j < line.args.size(); j++) {
+			string arg = convert_lower(address_part(line.args[j]));
+			if (arg.size() == 0 || arg[0] == '$')
+				continue;
+			if ((int)j == target) {
+				if (where.find(arg) == where.end())
+					return false;	// jumps to an address
+			} else if (is_number(arg)) {
+				// An immediate out of range spills into the other fields, and lw and sw
+				// with $0 reach a fixed address, maybe in the program
+				int imm = stoi(arg);
+				if (line.op != ".fill" && (imm < -64 || imm > 63))
+					return false;
+				if ((line.op == "lw" || line.op == "sw") && base_register(line.args[j]) == "$0" &&
+					imm >= 0 && (size_t)imm < lines.size())
+					return false;
+			} else {
+				auto found = where.find(arg);
+				if (found != where.end() && found->second < lines.size() && lines[found->second].op != ".fill")
+					return false;	// uses the address of an instruction
+			}
+		}
+	}
+	return true;
+}
+
+// Takes in the lines and whether to thread jeq as well as j and jal
+// Makes jumps to a j go straight to where that j goes
+// Returns true if anything changed
+bool thread_jumps(vector<Line>& lines, bool thread_jeq) {
+	unordered_map<string, size_t> where = label_lines(lines);
+	bool changed = false;
+	for (Line &line : lines) {
+		int target = target_arg(line);
+		if (line.removed || target < 0 || (line.op == "jeq" && !thread_jeq))
+			continue;
+		// A cycle of jumps stops after as many steps as there are lines
+		for (size_t steps = 0; steps < lines.size(); steps++) {
+			size_t to = where[convert_lower(line.args[target])];
+			if (to >= lines.size() || lines[to].op != "j" || lines[to].args[0] == line.args[target])
+				break;
+			line.args[target] = lines[to].args[0];
+			changed = true;
+		}
+	}
+	return changed;
+}
+
+// Takes in the lines of the program as written
+// Returns false, after printing why, if an instruction other than .fill follows a
+// j, jr or halt without a label, since only simcache --entry could reach it
+bool entries_labeled(const vector<Line>& lines) {
+	for (size_t i = 1; i < lines.size(); i++) {
+		const string &before = lines[i-1].op;
+		if ((before == "j" || before == "jr" || before == "halt") && lines[i].labels.size() == 0 &&
+				lines[i].op != ".fill") {
+			cerr << "Can't optimize: the instruction at " << i << " follows a " << before <<
+				" with no label. Label it if --entry starts a core there" << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// Takes in the lines
+// Removes the instructions that no path from the start or from a label reaches
+// Returns true if anything changed
+bool remove_unreachable(vector<Line>& lines) {
+	unordered_map<string, size_t> where = label_lines(lines);
+	vector<bool> reached(lines.size(), false);
+	vector<size_t> work = {0};
+	for (size_t i = 0; i < lines.size(); i++) {
+		if (!lines[i].removed && (lines[i].labels.size() > 0 || lines[i].op == ".fill"))
+			work.push_back(i);
+	}
+	while (work.size() > 0) {
+		size_t i = next_line(lines, work.back());
+		work.pop_back();
+		if (i >= lines.size() || reached[i])
+			continue;
+		reached[i] = true;
+		const Line &line = lines[i];
+		int target = target_arg(line);
+		if (target >= 0)
+			work.push_back(where[convert_lower(line.args[target])]);
+		if (line.op != "j" && line.op != "jr" && line.op != "halt")
+			work.push_back(i + 1);
+	}
+
+	bool changed = false;
+	for (size_t i = 0; i < lines.size(); i++) {
+		if (!lines[i].removed && !reached[i]) {
+			remove_line(lines, i);
+			changed = true;
+		}
+	}
+	return changed;
+}
+
+// Takes in the lines
+// Removes nops, instructions other than lw that only write $0, and j or jeq to
+// the next instruction
+// Returns true if anything changed
+bool remove_nops(vector<Line>& lines) {
+	bool changed = false;
+	for (size_t i = 0; i < lines.size(); i++) {
+		Line &line = lines[i];
+		if (line.removed)
+			continue;
+		bool nop = line.op == "nop" || (written_register(line) == 0 && line.op != "lw");
+		int target = target_arg(line);
+		if ((line.op == "j" || line.op == "jeq") && label_lines(lines)[convert_lower(line.args[target])] ==
+			next_line(lines, i + 1))
+			nop = true;
+		if (nop) {
+			remove_line(lines, i);
+			changed = true;
+		}
+	}
+	return changed;
+}
+
+// Takes in a 16-bit value and returns true if movi can set a register to it
+bool fits_immediate(unsigned value) {
+	return value <= 63 || value >= 65536 - 64;
+}
+
+// Takes in the lines
+// Within each basic block, tracks the registers holding known constants. An
+// instruction whose result is a constant that fits in an immediate becomes movi,
+// addi chains on one register merge, and a write overwritten before it is read
+// is removed. lw is never removed, since the access still reaches the caches.
+// Returns true if anything changed
+bool fold_constants(vector<Line>& lines) {
+	bool changed = false;
+	bool known[8] = {true};
+	unsigned value[8] = {};
+	int last_write[8] = {-1, -1, -1, -1, -1, -1, -1, -1};	// removable line that wrote the register, not read since
+	for (size_t i = 0; i < lines.size(); i++) {
+		Line &line = lines[i];
+		if (line.removed)
+			continue;
+		if (line.labels.size() > 0) {
+			// A block starts: nothing is known
+			for (int r = 0; r < 8; r++) {
+				known[r] = (r == 0);
+				value[r] = 0;
+				last_write[r] = -1;
+			}
+		}
+
+		int dst = written_register(line);
+		bool numeric = true;	// every immediate is a number, not a label
+		for (const string &arg : line.args)
+			numeric = numeric && (arg[0] == '$' || is_number(address_part(arg)));
+		vector<int> reads = read_registers(line);
+
+		// Work out the result if it is a constant
+		bool constant = false;
+		unsigned result = 0;
+		if (dst > 0 && numeric && line.op != "lw" && line.op != "jal") {
+			constant = true;
+			for (int r : reads)
+				constant = constant && known[r];
+			if (constant) {
+				unsigned a = reads.size() > 0 ? value[reads[0]] : 0;
+				unsigned b = reads.size() > 1 ? value[reads[1]] : 0;
+				unsigned imm = (line.op == "movi") ? stoi(line.args[1]) : (line.op == "addi" || line.op == "slti") ?
+					stoi(line.args[2]) : 0;
+				imm &= 65535;
+				if (line.op == "add")
+					result = a + b;
+				else if (line.op == "sub")
+					result = a - b;
+				else if (line.op == "or")
+					result = a | b;
+				else if (line.op == "and")
+					result = a & b;
+				else if (line.op == "slt")
+					result = a < b;
+				else if (line.op == "slti")
+					result = a < imm;
+				else
+					result = a + imm;	// addi, movi
+				result &= 65535;
+			}
+		}
+
+		if (constant && fits_immediate(result)) {
+			string imm = to_string(result <= 63 ? (int)result : (int)result - 65536);
+			if (line.op != "movi" || line.args[1] != imm) {
+				line.op = "movi";
+				line.args = {line.args[0], imm};
+				changed = true;
+			}
+			reads.clear();
+		} else if (line.op == "addi" && numeric && dst > 0 && reg_to_int(line.args[1]) == dst &&
+			last_write[dst] >= 0 && lines[last_write[dst]].op == "addi" &&
+			reg_to_int(lines[last_write[dst]].args[1]) == dst) {
+			// addi $d,$d,a then addi $d,$d,b, with nothing reading $d between
+			int sum = stoi(lines[last_write[dst]].args[2]) + stoi(line.args[2]);
+			if (sum >= -64 && sum <= 63) {
+				line.args[2] = to_string(sum);
+				remove_line(lines, last_write[dst]);
+				last_write[dst] = -1;
+				changed = true;
+			}
+		}
+
+		for (int r : reads)
+			last_write[r] = -1;
+		if (dst > 0) {
+			if (last_write[dst] >= 0) {
+				remove_line(lines, last_write[dst]);
+				changed = true;
+			}
+			known[dst] = constant;
+			value[dst] = result;
+			last_write[dst] = (line.op == "lw" || line.op == "jal") ? -1 : i;
+		}
+
+		if (ends_block(line)) {
+			for (int r = 0; r < 8; r++) {
+				known[r] = (r == 0);
+				last_write[r] = -1;
+			}
+		}
+	}
+	return changed;
+}
+
+// Takes in the lines
+// Returns the address of each line once the removed ones are gone and every
+// .fill is back at its address, and of the end of the program
+vector<size_t> layout(const vector<Line>& lines) {
+	vector<size_t> address(lines.size() + 1);
+	size_t count = 0;
+	for (size_t i = 0; i < lines.size(); i++) {
+		if (lines[i].op == ".fill" && !lines[i].removed)
+			count = lines[i].address;
+		address[i] = count;
+		if (!lines[i].removed)
+			count++;
+	}
+	address[lines.size()] = count;
+	return address;
+}
+
+// Takes in the lines
+// Returns them as a 2D vector of strings, each instruction with its labels
+vector<vector<string>> build_program(const vector<Line>& lines) {
+	vector<vector<string>> result;
+	vector<size_t> address = layout(lines);
+	for (size_t i = 0; i < lines.size(); i++) {
+		const Line &line = lines[i];
+		if (line.removed)
+			continue;
+		while (result.size() < address[i])
+			result.push_back({".fill", "0"});
+		vector<string> row = line.labels;
+		row.push_back(line.op);
+		row.insert(row.end(), line.args.begin(), line.args.end());
+		result.push_back(row);
+	}
+	if (tail_labels.size() > 0)
+		result.push_back(tail_labels);
+	return result;
+}
+
+// Takes in the lines
+// Returns true if every jeq reaches its target with a 7-bit offset
+bool jeq_in_range(const vector<Line>& lines) {
+	unordered_map<string, size_t> where = label_lines(lines);
+	vector<size_t> address = layout(lines);
+	for (size_t i = 0; i < lines.size(); i++) {
+		if (lines[i].removed || lines[i].op != "jeq")
+			continue;
+		int offset = (int)address[next_line(lines, where[convert_lower(lines[i].args[2])])] - (int)address[i] - 1;
+		if (offset < -64 || offset > 63)
+			return false;
+	}
+	return true;
+}
+
+// Takes in a 2D vector of strings holding the program as written
+// Returns the optimized program in the same form
+vector<vector<string>> optimize(const vector<vector<string>>& everything) {
+	for (bool thread_jeq : {true, false}) {
+		vector<Line> lines = build_lines(everything);
+		if (!can_move(lines))
+			break;
+		bool changed = true;
+		for (int pass = 0; changed && pass < 100; pass++) {
+			changed = thread_jumps(lines, thread_jeq);
+			changed = remove_unreachable(lines) || changed;
+			changed = remove_nops(lines) || changed;
+			changed = fold_constants(lines) || changed;
+		}
+		// Threading a jeq can take it out of reach of its target
+		if (jeq_in_range(lines))
+			return build_program(lines);
+	}
+	return everything;
+}
+
+/*
+	Data layout (--layout)
+
+	Takes the L1 geometry of a cache, as in the --cache option of simcache, and
+	pads the labeled data after the last instruction so that arrays walked side
+	by side don't evict each other. Each label in that data starts a region. The
+	model assumes the regions are walked together, word k of one with word k of
+	the others, and counts the offsets where as many regions as the associativity
+	already sit in the set of a new one. Regions are placed in order, each after
+	the smallest padding that adds the fewest conflicts with those before it.
+
+	A region only counts if the code refers to its label, or a .fill in a region
+	that counts holds its address. A profile written by simcache --profile weighs
+	each reference by how often it ran, so data only used by cold code doesn't
+	push the hot arrays around.
+
+	Regions keep their order and only move by padding, so code mustn't reach one
+	region from the label of another. A label used as an immediate that fits in
+	7 bits is kept below 64.
+*/
+
+// A stretch of labeled data to place
+struct Region {
+	vector<vector<string>> rows;
+	long weight = 0;			// references from the code
+	bool immediate = false;		// its label is an immediate, and fits one as written
+};
+
+// A region already placed, as the model sees it
+struct Placed {
+	size_t start;
+	size_t length;
+	long weight;
+};
+
+// Takes in the rows of a region and the address it starts at
+// Returns the words before its first label and the words after
+pair<size_t, size_t> region_words(const vector<vector<string>>& rows, size_t address) {
+	size_t before = 0, after = 0;
+	bool labeled = false;
+	for (const vector<string> &row : rows) {
+		labeled = labeled || contains(row[0], ':');
+		size_t words = row_words(row, address + before + after);
+		(labeled ? after : before) += words;
+	}
+	return {before, after};
+}
+
+// Takes in the regions placed so far, the start, length and weight of a new one,
+// and the sets, associativity and blocksize of the cache
+// Returns the weight of the conflicts the new region adds
+long conflicts(const vector<Placed>& placed, size_t start, size_t length, long weight,
+	size_t sets, size_t assoc, size_t blocksize) {
+	long cost = 0;
+	for (size_t k = 0; k < length; k++) {
+		size_t block = (start + k) / blocksize;
+		size_t count = 0;
+		long shared = 0;
+		for (const Placed &other : placed) {
+			size_t other_block = (other.start + k) / blocksize;
+			if (k < other.length && other_block != block && other_block % sets == block % sets) {
+				count++;
+				shared += min(weight, other.weight);
+			}
+		}
+		if (count >= assoc)
+			cost += shared;
+	}
+	return cost;
+}
+
+// Takes in the name of a listing written by simcache --profile
+// Fills in the times each pc ran
+// Returns false if the file can't be read
+bool read_profile(const string &filename, unordered_map<size_t, long>& executed) {
+	ifstream f(filename);
+	if (!f.is_open())
+		return false;
+	string line;
+	getline(f, line);	// header
+	while (getline(f, line)) {
+		istringstream fields(line);
+		size_t pc;
+		long count;
+		if (fields >> pc >> count)
+			executed[pc] = count;
+	}
+	return true;
+}
+
+// Takes in the regions, the index of one and the address it would start at
+// Returns true if every region from it on whose label is an immediate still
+// fits one when nothing after it is padded
+bool immediates_fit(const vector<Region>& regions, size_t from, size_t address) {
+	for (size_t r = from; r < regions.size(); r++) {
+		pair<size_t, size_t> words = region_words(regions[r].rows, address);
+		if (regions[r].immediate && address + words.first > 63)
+			return false;
+		address += words.first + words.second;
+	}
+	return true;
+}
+
+// Takes in a 2D vector of strings holding the program, the geometry of the cache
+// and the times each pc ran, or an empty map to count every reference once
+// Pads the data after the last instruction as described above
+void place_data(vector<vector<string>>& everything, size_t sets, size_t assoc, size_t blocksize,
+	const unordered_map<size_t, long>& executed) {
+	// The data starts after the last row that is an instruction
+	size_t first = 0, address = 0, data_address = 0;
+	for (size_t i = 0; i < everything.size(); i++) {
+		string operation = row_operation(everything[i]);
+		address += row_words(everything[i], address);
+		if (operation != "" && operation != ".fill" && operation != ".space" && operation != ".align") {
+			first = i + 1;
+			data_address = address;
+		}
+	}
+
+	// Split the data at its labels. An .align just before a label goes with it.
+	vector<Region> regions(1);
+	unordered_map<string, size_t> region_of;
+	for (size_t i = first; i < everything.size(); i++) {
+		const vector<string> &row = everything[i];
+		if (contains(row[0], ':')) {
+			Region next;
+			vector<vector<string>> &rows = regions.back().rows;
+			while (rows.size() > 0 && row_operation(rows.back()) == ".align" && !contains(rows.back()[0], ':')) {
+				next.rows.insert(next.rows.begin(), rows.back());
+				rows.pop_back();
+			}
+			regions.push_back(next);
+			for (const string &word : row) {
+				if (contains(word, ':'))
+					region_of[convert_lower(word.substr(0, word.size()-1))] = regions.size() - 1;
+			}
+		}
+		regions.back().rows.push_back(row);
+	}
+
+	// Weigh each region by the instructions that refer to its label, and find the
+	// labels used as immediates
+	address = 0;
+	vector<bool> used_as_immediate(regions.size(), false);
+	for (size_t i = 0; i < first; i++) {
+		const vector<string> &row = everything[i];
+		string operation = row_operation(row);
+		auto count = executed.find(address);
+		for (const string &word : row) {
+			auto found = region_of.find(convert_lower(contains(word, ')') ? word.substr(0, word.size()-4) : word));
+			if (found == region_of.end())
+				continue;
+			regions[found->second].weight += executed.empty() ? 1 : (count != executed.end()) ? count->second : 0;
+			if (operation != ".fill" && operation != "j" && operation != "jal" && operation != "jeq")
+				used_as_immediate[found->second] = true;
+		}
+		address += row_words(row, address);
+	}
+	// Data holding the address of a region, like a table of pointers, passes its
+	// weight on to it
+	for (size_t r = 0; r < regions.size(); r++) {
+		for (const vector<string> &row : regions[r].rows) {
+			auto found = region_of.find(convert_lower(row.back()));
+			if (row_operation(row) == ".fill" && found != region_of.end() && found->second != r)
+				regions[found->second].weight += regions[r].weight;
+		}
+	}
+	address = data_address;
+	for (size_t r = 0; r < regions.size(); r++) {
+		pair<size_t, size_t> words = region_words(regions[r].rows, address);
+		regions[r].immediate = used_as_immediate[r] && address + words.first <= 63;
+		address += words.first + words.second;
+	}
+
+	// Place the regions in order, each after the padding that adds the fewest conflicts
+	vector<vector<string>> result(everything.begin(), everything.begin() + first);
+	vector<Placed> placed;
+	address = data_address;
+	for (size_t r = 0; r < regions.size(); r++) {
+		const Region &region = regions[r];
+		size_t best_pad = 0;
+		long best_cost = -1;
+		size_t tries = (region.weight > 0) ? sets * blocksize : 1;
+		for (size_t pad = 0; pad < tries; pad++) {
+			pair<size_t, size_t> words = region_words(region.rows, address + pad);
+			size_t start = address + pad + words.first;
+			if (pad > 0 && (start + words.second > 8192 || !immediates_fit(regions, r, address + pad)))
+				break;
+			long cost = conflicts(placed, start, words.second, region.weight, sets, assoc, blocksize);
+			if (best_cost < 0 || cost < best_cost) {
+				best_pad = pad;
+				best_cost = cost;
+			}
+			if (cost == 0)
+				break;
+		}
+
+		if (best_pad > 0)
+			result.push_back({".space", to_string(best_pad)});
+		result.insert(result.end(), region.rows.begin(), region.rows.end());
+		pair<size_t, size_t> words = region_words(region.rows, address + best_pad);
+		if (region.weight > 0)
+			placed.push_back({address + best_pad + words.first, words.second, region.weight});
+		address += best_pad + words.first + words.second;
+	}
+	everything = result;
+}
+
+/*
+	Object files (-c)
+
+	asm -c writes a module for link.exe to join with others, instead of a
+	program. The machine code is laid out as if the module started at address 0,
+	and is followed by:
+		align N					the boundary the module has to start on, for its .align
+		global NAME ADDRESS		a label other modules can use, declared with .global NAME
+		reloc ADDRESS KIND		a word whose operand is an address in the module, to
+								which the linker adds the address the module starts at
+		reloc ADDRESS KIND NAME	a word whose operand the linker sets to the address of
+								NAME, a label the module doesn't define
+	KIND is j for the 13-bit address of j, jal and halt, imm for the 7-bit
+	immediate of lw, sw, addi, movi and slti, jeq for the 7-bit offset of jeq,
+	and fill for a .fill word.
+*/
+
+// A word of an object file whose operand the linker fills in
+struct Relocation {
+	size_t address;
+	string kind;
+	string symbol;	// "" for an address in the module
+};
+
+// Takes in a 2D vector of strings and removes the .global directives, keeping
+// any labels on them
+// Returns the names they declare, in lowercase
+vector<string> take_globals(vector<vector<string>>& everything) {
+	vector<string> names;
+	vector<vector<string>> result;
+	for (size_t i = 0; i < everything.size(); i++) {
+		string operation = row_operation(everything[i]);
+		if (operation != ".global" && operation != ".globl") {
+			result.push_back(everything[i]);
+			continue;
+		}
+		vector<string> labels;
+		bool declared = false;
+		for (const string &word : everything[i]) {
+			if (contains(word, ':'))
+				labels.push_back(word);
+			else if (declared)
+				names.push_back(convert_lower(word));
+			else
+				declared = true;
+		}
+		if (labels.size() > 0)
+			result.push_back(labels);
+	}
+	everything = result;
+	return names;
+}
+
+// Takes in a 2D vector of strings and returns the smallest boundary that every
+// .align in it divides
+size_t module_alignment(const vector<vector<string>>& everything) {
+	size_t boundary = 1;
+	for (const vector<string> &row : everything) {
+		if (row_operation(row) == ".align" && is_number(row.back()) && stoi(row.back()) > 0)
+			boundary = lcm(boundary, (size_t)stoi(row.back()));
+	}
+	return boundary;
+}
+
+// Takes in a 2D vector of strings, with its labels in the labels map
+// Replaces the labels it doesn't define with 0
+// Returns the relocations of its words
+vector<Relocation> find_relocations(vector<vector<string>>& everything) {
+	vector<Relocation> result;
+	size_t pc = 0;
+	for (size_t i = 0; i < everything.size(); i++) {
+		string operation = row_operation(everything[i]);
+		if (operation == "")
+			continue;
+		string kind = "imm";
+		if (operation == "j" || operation == "jal" || operation == "halt")
+			kind = "j";
+		else if (operation == "jeq")
+			kind = "jeq";
+		else if (operation == ".fill")
+			kind = "fill";
+		if (operation == "halt")
+			result.push_back({pc, kind, ""});
+
+		bool operand = false;
+		for (string &word : everything[i]) {
+			if (contains(word, ':'))
+				continue;
+			if (!operand) {
+				operand = true;
+				continue;
+			}
+			string reg = contains(word, ')') ? word.substr(word.size()-4) : "";
+			string name = convert_lower(word.substr(0, word.size() - reg.size()));
+			if (name.size() == 0 || name[0] == '$' || is_number(name))
+				continue;
+			if (labels.find(name) == labels.end()) {
+				result.push_back({pc, kind, name});
+				word = "0" + reg;
+			} else if (kind != "jeq")
+				result.push_back({pc, kind, ""});
+		}
+		pc++;
+	}
+	return result;
+}
+
 /**
 	Main function
 	Takes command-line args as documented below
@@ -398,12 +1280,27 @@ int main(int argc, char *argv[]) {
 	*/
 	char *filename = nullptr;
 	bool do_help = false;
+	bool do_optimize = false;
+	bool do_object = false;
+	bool do_comments = false;
+	string layout = "";
+	string layout_profile = "";
 	bool arg_error = false;
 	for (int i=1; i<argc; i++) {
 		string arg(argv[i]);
 		if (arg.rfind("-",0)==0) {
 			if (arg== "-h" || arg == "--help")
 				do_help = true;
+			else if (arg == "-O")
+				do_optimize = true;
+			else if (arg == "-c")
+				do_object = true;
+			else if (arg == "-g")
+				do_comments = true;
+			else if (arg == "--layout" && i + 1 < argc)
+				layout = argv[++i];
+			else if (arg == "--layout-profile" && i + 1 < argc)
+				layout_profile = argv[++i];
 			else
 				arg_error = true;
 		} else {
@@ -413,14 +1310,43 @@ int main(int argc, char *argv[]) {
 				arg_error = true;
 		}
 	}
+	// The cache to lay the data out for: size, associativity and blocksize of L1,
+	// with any further levels ignored
+	vector<string> geometry = parse_line(layout);
+	size_t sets = 0, assoc = 0, blocksize = 0;
+	if (layout != "") {
+		bool numeric = geometry.size() >= 3 && geometry.size() % 3 == 0;
+		for (size_t i = 0; numeric && i < 3; i++)
+			numeric = is_number(geometry[i]) && stoi(geometry[i]) > 0;
+		if (numeric) {
+			assoc = stoi(geometry[1]);
+			blocksize = stoi(geometry[2]);
+			sets = stoi(geometry[0]) / (assoc * blocksize);
+		}
+		if (sets == 0 || sets * assoc * blocksize != (size_t)stoi(geometry[0]))
+			arg_error = true;
+	}
+	if ((layout_profile != "" && layout == "") || (do_object && layout != ""))
+		arg_error = true;
+
 	/* Display error message if appropriate */
 	if (arg_error || do_help || filename == nullptr) {
-		cerr << "usage " << argv[0] << " [-h] filename" << endl << endl; 
+		cerr << "usage " << argv[0] << " [-h] [-O] [-c] [-g] [--layout CACHE [--layout-profile FILE]] filename" << endl << endl; 
 		cerr << "Assemble E20 files into machine code" << endl << endl;
 		cerr << "positional arguments:" << endl;
 		cerr << "  filename    The file containing assembly language, typically with .s suffix" << endl<<endl;
 		cerr << "optional arguments:"<<endl;
-		cerr << "  -h, --help  show this help message and exit"<<endl;
+		cerr << "  -h, --help              show this help message and exit"<<endl;
+		cerr << "  -O                      remove dead code, nops and jumps to jumps, and fold constants."<<endl;
+		cerr << "                          Code that only simcache --entry reaches must be labeled. It"<<endl;
+		cerr << "                          moves, and -g shows where in the comments of the output"<<endl;
+		cerr << "  -c                      write an object file for link.exe instead of a program"<<endl;
+		cerr << "  -g                      put the source of each word after it as a comment, as in"<<endl;
+		cerr << "                          the tests-cache .bin files, for simcache --profile"<<endl;
+		cerr << "  --layout CACHE          pad the labeled data after the code to avoid set conflicts"<<endl;
+		cerr << "                          in a cache given as for simcache --cache (L1 is used)"<<endl;
+		cerr << "  --layout-profile FILE   weigh the data by a listing from simcache --profile of the"<<endl;
+		cerr << "                          program as written"<<endl;
 		return 1;
 	}
 
@@ -456,9 +1382,50 @@ int main(int argc, char *argv[]) {
 		}
 	}
 
+	// Take out the labels declared for other modules.
+	vector<string> globals = take_globals(program);
+	size_t alignment = module_alignment(program);
+
+	if (layout != "") {
+		unordered_map<size_t, long> executed;
+		if (layout_profile != "" && !read_profile(layout_profile, executed)) {
+			cerr << "Can't open file "<<layout_profile<<endl;
+			return 1;
+		}
+		place_data(program, sets, assoc, blocksize, executed);
+	}
+
+	// Turn .space and .align into .fill words.
+	if (!expand_directives(program))
+		return 1;
+
+	if (do_optimize) {
+		if (!entries_labeled(build_lines(program)))
+			return 1;
+		program = optimize(program);
+	}
+
+	// Keep the source of each instruction for the comments.
+	vector<string> comments;
+	if (do_comments)
+		comments = source_comments(program);
+
 	// Add value of our labels into unordered map.
 	update_labels(program);
 
+	// An object file leaves the addresses that depend on where the module goes
+	// to the linker.
+	vector<Relocation> relocations;
+	if (do_object) {
+		for (const string &name : globals) {
+			if (labels.find(name) == labels.end()) {
+				cerr << "Global label " << name << " isn't defined" << endl;
+				return 1;
+			}
+		}
+		relocations = find_relocations(program);
+	}
+
 	// Replace all instances of labels with its value.
 	substitute_labels(program);
 
@@ -471,9 +1438,21 @@ int main(int argc, char *argv[]) {
 	/* print out each instruction in the required format */
 	unsigned address = 0;
 	for (unsigned instruction : instructions) {
-		print_machine_code(address, instruction); 
+		print_machine_code(address, instruction, (address < comments.size()) ? comments[address] : "");
 		address ++;
 	}
+
+	if (do_object) {
+		cout << "align " << alignment << endl;
+		for (const string &name : globals)
+			cout << "global " << name << " " << labels[name] << endl;
+		for (const Relocation &relocation : relocations) {
+			cout << "reloc " << relocation.address << " " << relocation.kind;
+			if (relocation.symbol != "")
+				cout << " " << relocation.symbol;
+			cout << endl;
+		}
+	}
  
 	return 0;
 }
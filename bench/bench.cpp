@@ -0,0 +1,368 @@
+/*
+bench.cpp
+
+Throughput harness for asm and simcache (make bench). Generates synthetic
+E20 workloads, assembles them and the tests-cache programs, simulates each
+under several cache configurations, and writes one CSV row per measurement.
+*/
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <regex>
+#include <random>
+#include <chrono>
+#include <algorithm>
+
+using namespace std;
+
+size_t const static MEM_SIZE = 1<<13;
+
+// Cache configurations every workload is simulated under
+const vector<string> configs = {
+	"--cache 64,1,1",
+	"--cache 64,4,4,1024,8,8 --write-policy wb",
+	"--cache 256,16,4,2048,16,16 --write-policy wb",
+	"--cache 32,2,2,256,4,4,2048,8,8 --write-policy wb,wb,wb",
+};
+
+// Configurations simulated again with the log on, to time writing it
+const vector<string> log_configs = {
+	"--cache 64,4,4,1024,8,8 --write-policy wb",
+	"--cache 64,4,4,1024,8,8 --write-policy wb --host-pipeline",
+};
+
+// Builds the text of an E20 program. Large constants are built from movi and adds,
+// since immediates only hold 7 bits.
+struct Program {
+	stringstream text;
+	size_t words = 0;
+
+	void op(const string &line) {
+		text << "    " << line << endl;
+		words++;
+	}
+
+	void label(const string &name) {
+		text << name << ":" << endl;
+	}
+
+	// Takes a register and a value below MEM_SIZE
+	// Emits code that sets the register to the value, one bit at a time
+	void constant(int reg, unsigned value) {
+		string r = "$" + to_string(reg);
+		op("movi " + r + ", 0");
+		for (int bit = 12; bit >= 0; bit--) {
+			op("add " + r + ", " + r + ", " + r);
+			if ((value >> bit) & 1)
+				op("addi " + r + ", " + r + ", 1");
+		}
+	}
+
+	// Takes a loop counter register, a register holding the count, and the label of
+	// the top of the loop
+	// Emits the increment and the branch back while the counter is below the count
+	void loop_back(int counter, int count, const string &top) {
+		string c = "$" + to_string(counter);
+		op("addi " + c + ", " + c + ", 1");
+		op("slt $6, " + c + ", $" + to_string(count));
+		op("jeq $6, $0, " + top + "_end");
+		op("j " + top);
+		label(top + "_end");
+	}
+};
+
+// Region of memory the generated workloads work on
+unsigned const static REGION = 4096;
+
+// Takes the number of passes
+// Returns a program that increments every word of the region in order
+string stream_workload(int passes) {
+	Program p;
+	p.constant(5, REGION);			// $5 = end of the region
+	p.op("add $5, $5, $5");
+	p.constant(7, passes);
+	p.op("movi $1, 0");				// pass counter
+	p.label("pass");
+	p.constant(4, REGION);			// pointer
+	p.label("elem");
+	p.op("lw $3, 0($4)");
+	p.op("addi $3, $3, 1");
+	p.op("sw $3, 0($4)");
+	p.op("addi $4, $4, 1");
+	p.op("slt $6, $4, $5");
+	p.op("jeq $6, $0, elem_end");
+	p.op("j elem");
+	p.label("elem_end");
+	p.loop_back(1, 7, "pass");
+	p.op("halt");
+	return p.text.str();
+}
+
+// Takes the number of passes
+// Returns a program that reads the region 32 words apart, starting at every offset in turn
+string stride_workload(int passes) {
+	Program p;
+	p.constant(5, 2 * REGION);		// $5 = end of the region
+	p.constant(7, passes);
+	p.op("movi $1, 0");				// pass counter
+	p.label("pass");
+	p.op("movi $2, 0");				// offset
+	p.label("offset");
+	p.constant(4, REGION);
+	p.op("add $4, $4, $2");
+	p.label("elem");
+	p.op("lw $3, 0($4)");
+	p.op("addi $4, $4, 32");
+	p.op("slt $6, $4, $5");
+	p.op("jeq $6, $0, elem_end");
+	p.op("j elem");
+	p.label("elem_end");
+	p.op("addi $2, $2, 1");
+	p.op("slti $6, $2, 32");
+	p.op("jeq $6, $0, offset_end");
+	p.op("j offset");
+	p.label("offset_end");
+	p.loop_back(1, 7, "pass");
+	p.op("halt");
+	return p.text.str();
+}
+
+// Takes the number of passes and whether the data addresses depend on the loads
+// Returns a program that visits the region in a random order: as a linked list whose
+// nodes hold the address of the next one, or as a table of addresses read in order
+string random_workload(int passes, bool chase) {
+	const size_t nodes = 1024;
+	mt19937 rng(chase ? 1 : 2);
+	vector<unsigned> order(REGION);
+	for (size_t i = 0; i < REGION; i++)
+		order[i] = REGION + i;
+	shuffle(order.begin(), order.end(), rng);
+	order.resize(nodes);
+
+	Program p;
+	p.constant(7, passes);
+	p.op("movi $1, 0");				// pass counter
+	p.label("pass");
+	p.constant(5, nodes);
+	p.op("movi $2, 0");				// node counter
+	if (chase)
+		p.constant(4, order[0]);	// current node
+	else
+		p.op("movi $4, 0");			// table index
+	p.label("elem");
+	if (chase)
+		p.op("lw $4, 0($4)");
+	else {
+		p.op("lw $3, table($4)");
+		p.op("lw $3, 0($3)");
+		p.op("addi $4, $4, 1");
+	}
+	p.loop_back(2, 5, "elem");
+	p.loop_back(1, 7, "pass");
+	p.op("halt");
+
+	if (chase) {
+		// The list lives in the region, which the program fills before it starts
+		map<unsigned, unsigned> next;
+		for (size_t i = 0; i < nodes; i++)
+			next[order[i]] = order[(i + 1) % nodes];
+		p.label("data");
+		for (unsigned addr = p.words; addr < MEM_SIZE; addr++)
+			p.op(".fill " + to_string(next.count(addr) ? next[addr] : 0));
+	} else {
+		// The table has to sit within reach of a 7-bit immediate, so the program
+		// jumps over it
+		string code = p.text.str();
+		Program q;
+		q.op("j start");
+		q.label("table");
+		for (unsigned addr : order)
+			q.op(".fill " + to_string(addr));
+		q.label("start");
+		q.text << code;
+		return q.text.str();
+	}
+	return p.text.str();
+}
+
+// Takes a shell command
+// Returns its standard output and the seconds it took
+pair<string, double> run(const string &command) {
+	auto start = chrono::steady_clock::now();
+	string output;
+	FILE *pipe = popen(command.c_str(), "r");
+	if (pipe == nullptr) {
+		cerr << "Can't run " << command << endl;
+		exit(1);
+	}
+	char buffer[4096];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), pipe)) > 0)
+		output.append(buffer, n);
+	if (pclose(pipe) != 0) {
+		cerr << "Failed: " << command << endl;
+		exit(1);
+	}
+	return {output, chrono::duration<double>(chrono::steady_clock::now() - start).count()};
+}
+
+// Takes a file name and returns its number of lines
+size_t count_lines(const string &filename) {
+	ifstream f(filename);
+	return count(istreambuf_iterator<char>(f), istreambuf_iterator<char>(), '\n');
+}
+
+// One measurement, as a row of the CSV
+struct Result {
+	string tool;
+	string workload;
+	string config;
+	string metric;
+	double value;
+};
+
+// Takes the path of a CSV written by an earlier run
+// Returns its values by tool, workload, config and metric
+map<string, double> read_results(const string &filename) {
+	map<string, double> results;
+	ifstream f(filename);
+	string line;
+	getline(f, line);	// header
+	while (getline(f, line)) {
+		size_t last = line.rfind(',');
+		if (last != string::npos)
+			results[line.substr(0, last)] = stod(line.substr(last + 1));
+	}
+	return results;
+}
+
+int main(int argc, char *argv[]) {
+	int scale = 1;
+	int repeats = 20;		// runs of asm per program
+	int sim_repeats = 3;	// runs of simcache per program and configuration
+	string output = "bench/results.csv";
+	string baseline;
+	double tolerance = 10;
+	for (int i = 1; i < argc; i++) {
+		string arg(argv[i]);
+		if (i + 1 < argc && arg == "--scale")
+			scale = max(1, stoi(argv[++i]));
+		else if (i + 1 < argc && arg == "--repeats")
+			repeats = max(1, stoi(argv[++i]));
+		else if (i + 1 < argc && arg == "--sim-repeats")
+			sim_repeats = max(1, stoi(argv[++i]));
+		else if (i + 1 < argc && arg == "--output")
+			output = argv[++i];
+		else if (i + 1 < argc && arg == "--baseline")
+			baseline = argv[++i];
+		else if (i + 1 < argc && arg == "--tolerance")
+			tolerance = stod(argv[++i]);
+		else {
+			cerr << "usage " << argv[0] << " [--scale N] [--repeats N] [--sim-repeats N]" << endl;
+			cerr << "       [--output FILE] [--baseline FILE] [--tolerance PERCENT]" << endl;
+			return 1;
+		}
+	}
+
+	// Generate the workloads next to the copies of the tests-cache programs
+	vector<string> workloads = {"array-sum", "assoc2", "assoc2a", "stride4", "test", "write-through"};
+	for (string &name : workloads)
+		run("cp tests-cache/" + name + ".s bench/work/" + name + ".s");
+	map<string, string> generated = {
+		{"stream", stream_workload(4 * scale)},
+		{"strided", stride_workload(8 * scale)},
+		{"chase", random_workload(64 * scale, true)},
+		{"random", random_workload(32 * scale, false)},
+	};
+	for (auto &entry : generated) {
+		ofstream f("bench/work/" + entry.first + ".s");
+		f << "# Generated by bench/bench.cpp" << endl << entry.second;
+		workloads.push_back(entry.first);
+	}
+
+	vector<Result> results;
+	regex bench_re("Bench load words (\\d+), seconds (\\S+), run instructions (\\d+), "
+		"accesses (\\d+), seconds (\\S+)");
+	for (const string &name : workloads) {
+		string source = "bench/work/" + name + ".s";
+		string binary = "bench/work/" + name + ".bin";
+
+		// Every measurement keeps the fastest of its repeats, which is the least
+		// disturbed by the rest of the machine
+		double seconds = 0;
+		for (int i = 0; i < repeats; i++) {
+			double time = run("./asm.exe " + source + " > " + binary).second;
+			seconds = (i == 0) ? time : min(seconds, time);
+		}
+		results.push_back({"asm", name, "", "lines_per_second", count_lines(source) / seconds});
+
+		for (const string &config : configs) {
+			double load_rate = 0, mips = 0, access_rate = 0;
+			for (int i = 0; i < sim_repeats; i++) {
+				string stats = run("./simcache.exe " + config + " --quiet --bench " + binary).first;
+				smatch sm;
+				if (!regex_search(stats, sm, bench_re)) {
+					cerr << "No bench line from simcache for " << name << endl;
+					return 1;
+				}
+				load_rate = max(load_rate, stod(sm[1]) / stod(sm[2]));
+				mips = max(mips, stod(sm[3]) / stod(sm[5]) / 1e6);
+				access_rate = max(access_rate, stod(sm[4]) / stod(sm[5]));
+			}
+			string cache = config.substr(config.find(' ') + 1);
+			results.push_back({"simcache", name, cache, "load_words_per_second", load_rate});
+			results.push_back({"simcache", name, cache, "mips", mips});
+			results.push_back({"simcache", name, cache, "accesses_per_second", access_rate});
+		}
+
+		for (const string &config : log_configs) {
+			double access_rate = 0;
+			for (int i = 0; i < sim_repeats; i++) {
+				string stats = run("./simcache.exe " + config + " --bench " + binary + " | grep '^Bench'").first;
+				smatch sm;
+				if (!regex_search(stats, sm, bench_re)) {
+					cerr << "No bench line from simcache for " << name << endl;
+					return 1;
+				}
+				access_rate = max(access_rate, stod(sm[4]) / stod(sm[5]));
+			}
+			string cache = config.substr(config.find(' ') + 1);
+			results.push_back({"simcache", name, cache, "logged_accesses_per_second", access_rate});
+		}
+	}
+
+	// Write the results, then compare them with the baseline
+	map<string, double> old_results;
+	if (baseline.size() > 0)
+		old_results = read_results(baseline);
+	ofstream csv(output);
+	csv << "tool,workload,config,metric,value" << endl;
+	int regressions = 0;
+	for (const Result &result : results) {
+		string key = result.tool + "," + result.workload + ",\"" + result.config + "\"," + result.metric;
+		csv << key << "," << result.value << endl;
+		cout << left << setw(10) << result.tool << setw(15) << result.workload << setw(50) << result.config <<
+			setw(24) << result.metric << right << fixed << setprecision(2) << setw(14) << result.value;
+
+		auto old = old_results.find(key);
+		if (old != old_results.end() && result.value < old->second * (1 - tolerance / 100)) {
+			cout << "  REGRESSION from " << old->second;
+			regressions++;
+		}
+		cout << endl;
+	}
+	cout << "Wrote " << output << endl;
+	if (regressions > 0) {
+		cout << regressions << " metrics fell more than " << tolerance << "% below " << baseline << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,41 @@
+# Workload for the data layout mode (make layout).
+# Sums two arrays of 64 words side by side, 4 passes. As written, b starts 64
+# words after a, so a[i] and b[i] share a set in a 64-word direct-mapped cache.
+
+    lw $4, pa($0)           # $4 = a
+    lw $5, pb($0)           # $5 = b
+    movi $6, 32
+    add $6, $6, $6          # $6 = 64, the length of the arrays
+    movi $7, 0              # pass counter
+    movi $3, 0              # sum
+
+pass:
+    movi $1, 0              # index
+
+elem:
+    add $2, $4, $1
+    lw $2, 0($2)            # a[i]
+    add $3, $3, $2
+    add $2, $5, $1
+    lw $2, 0($2)            # b[i]
+    add $3, $3, $2
+    addi $1, $1, 1
+    slt $2, $1, $6
+    jeq $2, $0, endpass
+    j elem
+
+endpass:
+    addi $7, $7, 1
+    slti $2, $7, 4
+    jeq $2, $0, done
+    j pass
+
+done:
+    halt
+
+pa: .fill a
+pb: .fill b
+
+    .align 4
+a:  .space 64
+b:  .space 64
@@ -0,0 +1,17 @@
+# Library module of the linked example (make modules).
+
+.global sum
+
+# Takes the address of an array in $1 and its length in $2
+# Returns the sum of its words in $3, using $4
+sum:
+    movi $3, 0
+loop:
+    jeq $2, $0, done
+    lw $4, 0($1)
+    add $3, $3, $4
+    addi $1, $1, 1
+    addi $2, $2, -1
+    j loop
+done:
+    jr $7
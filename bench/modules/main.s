@@ -0,0 +1,21 @@
+# Entry module of the linked example (make modules). Sums a table with the
+# routine in array.s, then squares the sum with the one in math.s.
+
+main:
+    movi $1, table          # $1 = address of the table
+    movi $2, 5              # $2 = its length
+    jal sum
+    add $1, $3, $0
+    add $2, $3, $0
+    jal mul
+    sw $3, result($0)       # result = 225
+    halt
+
+table:
+    .fill 1
+    .fill 2
+    .fill 3
+    .fill 4
+    .fill 5
+result:
+    .fill 0
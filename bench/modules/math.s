@@ -0,0 +1,15 @@
+# Library module of the linked example (make modules).
+
+.global mul
+
+# Takes two numbers in $1 and $2
+# Returns their product in $3
+mul:
+    movi $3, 0
+loop:
+    jeq $2, $0, done
+    add $3, $3, $1
+    addi $2, $2, -1
+    j loop
+done:
+    jr $7
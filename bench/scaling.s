@@ -0,0 +1,149 @@
+# Workload for the --threads scaling benchmark (make scaling).
+# 32 cores each increment every word of their own 32-word region,
+# 50 rounds per pass and 4 passes. Core k starts at core_k (pc 2k)
+# and keeps its region at 1024 + 64k.
+
+core_0:
+    movi $1, 0
+    j work
+core_1:
+    movi $1, 1
+    j work
+core_2:
+    movi $1, 2
+    j work
+core_3:
+    movi $1, 3
+    j work
+core_4:
+    movi $1, 4
+    j work
+core_5:
+    movi $1, 5
+    j work
+core_6:
+    movi $1, 6
+    j work
+core_7:
+    movi $1, 7
+    j work
+core_8:
+    movi $1, 8
+    j work
+core_9:
+    movi $1, 9
+    j work
+core_10:
+    movi $1, 10
+    j work
+core_11:
+    movi $1, 11
+    j work
+core_12:
+    movi $1, 12
+    j work
+core_13:
+    movi $1, 13
+    j work
+core_14:
+    movi $1, 14
+    j work
+core_15:
+    movi $1, 15
+    j work
+core_16:
+    movi $1, 16
+    j work
+core_17:
+    movi $1, 17
+    j work
+core_18:
+    movi $1, 18
+    j work
+core_19:
+    movi $1, 19
+    j work
+core_20:
+    movi $1, 20
+    j work
+core_21:
+    movi $1, 21
+    j work
+core_22:
+    movi $1, 22
+    j work
+core_23:
+    movi $1, 23
+    j work
+core_24:
+    movi $1, 24
+    j work
+core_25:
+    movi $1, 25
+    j work
+core_26:
+    movi $1, 26
+    j work
+core_27:
+    movi $1, 27
+    j work
+core_28:
+    movi $1, 28
+    j work
+core_29:
+    movi $1, 29
+    j work
+core_30:
+    movi $1, 30
+    j work
+core_31:
+    movi $1, 31
+    j work
+
+work:
+    add $1, $1, $1          # $1 = 64 * core number
+    add $1, $1, $1
+    add $1, $1, $1
+    add $1, $1, $1
+    add $1, $1, $1
+    add $1, $1, $1
+    movi $2, 32             # $2 = 1024
+    add $2, $2, $2
+    add $2, $2, $2
+    add $2, $2, $2
+    add $2, $2, $2
+    add $2, $2, $2
+    add $1, $1, $2          # $1 = base of the region
+    movi $7, 0              # pass counter
+
+pass:
+    movi $6, 0              # round counter
+
+round:
+    add $4, $1, $0          # pointer to the current word
+    movi $5, 0              # word counter
+
+elem:
+    lw $3, 0($4)
+    addi $3, $3, 1
+    sw $3, 0($4)
+    addi $4, $4, 1
+    addi $5, $5, 1
+    slti $2, $5, 32
+    jeq $2, $0, endround
+    j elem
+
+endround:
+    addi $6, $6, 1
+    slti $2, $6, 50
+    jeq $2, $0, endpass
+    j round
+
+endpass:
+    addi $7, $7, 1
+    slti $2, $7, 4
+    jeq $2, $0, done
+    j pass
+
+done:
+    halt
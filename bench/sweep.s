@@ -0,0 +1,34 @@
+# Workload for the lockstep check (make lockstep).
+# Increments every word of the upper half of memory, 20 passes.
+
+    movi $6, 32             # $6 = 4096, start of the region
+    add $6, $6, $6
+    add $6, $6, $6
+    add $6, $6, $6
+    add $6, $6, $6
+    add $6, $6, $6
+    add $6, $6, $6
+    add $6, $6, $6
+    add $5, $6, $6          # $5 = 8192, end of the region
+    movi $7, 0              # pass counter
+
+pass:
+    add $4, $6, $0          # pointer to the current word
+
+elem:
+    lw $3, 0($4)
+    addi $3, $3, 1
+    sw $3, 0($4)
+    addi $4, $4, 1
+    slt $2, $4, $5
+    jeq $2, $0, endpass
+    j elem
+
+endpass:
+    addi $7, $7, 1
+    slti $2, $7, 20
+    jeq $2, $0, done
+    j pass
+
+done:
+    halt
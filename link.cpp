@@ -0,0 +1,206 @@
+/*
+link.cpp
+
+Linker for the E20 object files written by asm -c. Places the modules one
+after another in the order given, the first at address 0 where the program
+starts, fills in the operands named by their relocations, and writes the
+program in the machine code format of asm.
+*/
+
+#include <cstddef>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <regex>
+#include <bitset>
+#include <algorithm>
+
+using namespace std;
+
+size_t const static MEM_SIZE = 1<<13;
+
+// A word whose operand is filled in at link time
+struct Relocation {
+	size_t address;		// in the module
+	string kind;		// j, imm, jeq or fill
+	string symbol;		// "" for an address in the module
+};
+
+// One object file
+struct Module {
+	string filename;
+	vector<unsigned> words;
+	vector<string> comments;	// the rest of each machine code line
+	size_t alignment = 1;
+	map<string, size_t> globals;
+	vector<Relocation> relocations;
+	size_t base = 0;			// address the module starts at
+};
+
+// Takes the name of an object file
+// Reads it into module
+// Returns false, after printing why, if it can't be read
+bool read_module(const string &filename, Module &module) {
+	ifstream f(filename);
+	if (!f.is_open()) {
+		cerr << "Can't open file " << filename << endl;
+		return false;
+	}
+	module.filename = filename;
+
+	regex machine_code_re("^ram\\[(\\d+)\\] = 16'b([01]{16});(.*)$");
+	string line;
+	while (getline(f, line)) {
+		smatch sm;
+		istringstream fields(line);
+		string directive;
+		fields >> directive;
+		if (regex_match(line, sm, machine_code_re)) {
+			if (stoul(sm[1]) != module.words.size()) {
+				cerr << "Memory addresses encountered out of sequence in " << filename << ": " << sm[1] << endl;
+				return false;
+			}
+			module.words.push_back(stoul(sm[2], nullptr, 2));
+			module.comments.push_back(sm[3]);
+		} else if (directive == "align" && fields >> module.alignment && module.alignment > 0) {
+			continue;
+		} else if (directive == "global") {
+			string name;
+			size_t address;
+			if (!(fields >> name >> address)) {
+				cerr << "Can't parse line in " << filename << ": " << line << endl;
+				return false;
+			}
+			module.globals[name] = address;
+		} else if (directive == "reloc") {
+			Relocation relocation;
+			if (!(fields >> relocation.address >> relocation.kind) || relocation.address >= module.words.size()) {
+				cerr << "Can't parse line in " << filename << ": " << line << endl;
+				return false;
+			}
+			fields >> relocation.symbol;
+			module.relocations.push_back(relocation);
+		} else {
+			cerr << "Can't parse line in " << filename << ": " << line << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// Takes a word and the kind of its relocation
+// Returns the address in the word's operand, relative to its module
+int operand(unsigned word, const string &kind) {
+	if (kind == "j")
+		return word & (MEM_SIZE - 1);
+	if (kind == "imm")
+		return (word & 64) ? (int)(word & 127) - 128 : word & 127;
+	return word;	// fill
+}
+
+// Takes a word, the kind of its relocation, the address it now refers to and
+// the address of the word itself
+// Puts the address in the word's operand
+// Returns false if it doesn't fit
+bool patch(unsigned &word, const string &kind, int value, size_t address) {
+	if (kind == "j") {
+		if (value < 0 || value >= (int)MEM_SIZE)
+			return false;
+		word = (word & ~(unsigned)(MEM_SIZE - 1)) | value;
+	} else if (kind == "imm" || kind == "jeq") {
+		if (kind == "jeq")
+			value = value - address - 1;
+		if (value < -64 || value > 63)
+			return false;
+		word = (word & ~127u) | (value & 127);
+	} else if (kind == "fill") {
+		word = value & 65535;
+	} else
+		return false;
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+	vector<string> filenames;
+	bool arg_error = false;
+	for (int i = 1; i < argc; i++) {
+		string arg(argv[i]);
+		if (arg.rfind("-", 0) == 0)
+			arg_error = true;
+		else
+			filenames.push_back(arg);
+	}
+	if (arg_error || filenames.empty()) {
+		cerr << "usage " << argv[0] << " [-h] object..." << endl << endl;
+		cerr << "Link E20 object files written by asm -c into machine code" << endl << endl;
+		cerr << "positional arguments:" << endl;
+		cerr << "  object      An object file, typically with .o suffix. The first holds" << endl;
+		cerr << "              the start of the program, at address 0" << endl;
+		return 1;
+	}
+
+	// Place the modules and collect the labels they share
+	vector<Module> modules(filenames.size());
+	map<string, size_t> symbols;
+	map<string, string> defined_in;
+	size_t end = 0;
+	for (size_t i = 0; i < filenames.size(); i++) {
+		Module &module = modules[i];
+		if (!read_module(filenames[i], module))
+			return 1;
+		module.base = (end + module.alignment - 1) / module.alignment * module.alignment;
+		end = module.base + module.words.size();
+		if (end > MEM_SIZE) {
+			cerr << "Program too big for memory" << endl;
+			return 1;
+		}
+		for (const auto &global : module.globals) {
+			if (symbols.count(global.first)) {
+				cerr << "Label " << global.first << " is global in both " << defined_in[global.first] <<
+					" and " << module.filename << endl;
+				return 1;
+			}
+			symbols[global.first] = module.base + global.second;
+			defined_in[global.first] = module.filename;
+		}
+	}
+
+	// Fill in the relocations
+	for (Module &module : modules) {
+		for (const Relocation &relocation : module.relocations) {
+			unsigned &word = module.words[relocation.address];
+			int value;
+			if (relocation.symbol == "")
+				value = module.base + operand(word, relocation.kind);
+			else if (symbols.count(relocation.symbol))
+				value = symbols[relocation.symbol];
+			else {
+				cerr << "Undefined label " << relocation.symbol << " in " << module.filename << endl;
+				return 1;
+			}
+			if (!patch(word, relocation.kind, value, module.base + relocation.address)) {
+				cerr << "Address " << value << " doesn't fit the " << relocation.kind << " operand of word " <<
+					relocation.address << " in " << module.filename << endl;
+				return 1;
+			}
+		}
+	}
+
+	// Write the program, with zero words between modules that had to be aligned,
+	// commented like the words of the modules if they were assembled with -g
+	bool commented = false;
+	for (const Module &module : modules)
+		commented = commented || any_of(module.comments.begin(), module.comments.end(),
+			[](const string &comment) { return comment != ""; });
+	size_t address = 0;
+	for (const Module &module : modules) {
+		for (; address < module.base; address++)
+			cout << "ram[" << address << "] = 16'b" << bitset<16>(0) << ";" << (commented ? "\t\t// .fill 0" : "") << endl;
+		for (size_t i = 0; i < module.words.size(); i++, address++)
+			cout << "ram[" << address << "] = 16'b" << bitset<16>(module.words[i]) << ";" << module.comments[i] << endl;
+	}
+	return 0;
+}
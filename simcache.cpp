@@ -5,6 +5,7 @@ simcache.cpp
 */
 
 #include <cstddef>
+#include <cstdio>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -13,6 +14,27 @@ simcache.cpp
 #include <iomanip>
 #include <regex>
 #include <deque>
+#include <algorithm>
+#include <unordered_set>
+#include <unordered_map>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <bitset>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <csignal>
+#include <filesystem>
+#include <zlib.h>
+#include "simcache.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
@@ -36,45 +58,597 @@ void print_cache_config(const string &cache_name, int size, int assoc, int block
 		", rows " << num_rows << endl;
 }
 
-/*
-	Prints out a correctly-formatted log entry.
-
-	@param cache_name The name of the cache where the event
-		occurred. "L1" or "L2"
-
-	@param status The kind of cache event. "SW", "HIT", or
-		"MISS"
+bool log_enabled = true;	// cleared by --quiet
 
-	@param pc The program counter of the memory
-		access instruction
+bool record_cache_events = false;	// set by Simulator for its observer, and by --lockstep
+vector<CacheEvent> cache_events;	// recorded since the caller last cleared it
 
-	@param addr The memory address being accessed.
+bool use_host_pipeline = false;	// set by --host-pipeline
+bool host_pipeline = false;		// set while the cache model and the log run on threads of their own
 
-	@param row The cache row or set number where the data
-		is stored.
-*/
-void print_log_entry(const string &cache_name, const string &status, int pc, int addr, int row) {
-	cout << left << setw(8) << cache_name + " " + status <<  right <<
-		" pc:" << setw(5) << pc <<
-		"\taddr:" << setw(5) << addr <<
-		"\trow:" << setw(4) << row << endl;
-}
+// Kinds of log entry, printed by their names in LOG_STATUS_NAMES
+enum LogStatus : unsigned char { LOG_SW, LOG_HIT, LOG_MISS, LOG_WB, LOG_INV, LOG_PF };
+const char *const LOG_STATUS_NAMES[] = {"SW", "HIT", "MISS", "WB", "INV", "PF"};
 
 // Helpful constants
 size_t const static NUM_REGS = 8; 
 size_t const static MEM_SIZE = 1<<13;
 size_t const static REG_SIZE = 1<<16;
 
-// Initialize the processor state with global variables
-unsigned pc = 0;
-unsigned registers[NUM_REGS] = {};	// initialize every value to 0
+// Initialize the processor state with global variables.
+// pc and registers are per host thread so that cores can run on threads of their own.
+thread_local unsigned pc = 0;
+thread_local unsigned registers[NUM_REGS] = {};	// initialize every value to 0
 unsigned memory[MEM_SIZE] = {};	// initialize every value to 0
-vector<vector<int>> L1cache;
-vector<vector<int>> L2cache;
-vector<vector<int>> L1blockdata;
-vector<vector<int>> L2blockdata;
-vector<deque<int>> L1MRU;	// Vector of int deques to keep track of most recently used data in L1
-vector<deque<int>> L2MRU;	// Same for L2
+uint64_t memory_digest = 0;		// hash of memory[], kept up to date by store_word
+unsigned *model_memory = memory;	// memory[] as the cache model reads it: a copy of its
+								// own on the cache model thread of --host-pipeline
+
+// Takes a hash and a value, and returns the hash with the value mixed in (FNV-1a)
+uint64_t hash_mix(uint64_t hash, uint64_t value) {
+	for (int i = 0; i < 8; i++) {
+		hash ^= (value >> (8 * i)) & 255;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+uint64_t const static HASH_START = 14695981039346656037ULL;
+
+// Takes an address and the word at it
+// Returns the word's share of memory_digest, which is the XOR of the shares of every
+// word. A zero word adds nothing, so empty memory hashes to 0.
+uint64_t word_hash(unsigned addr, unsigned value) {
+	if (value == 0)
+		return 0;
+	uint64_t x = (((uint64_t)addr << 16) | value) + 0x9e3779b97f4a7c15ULL;	// splitmix64
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+// Takes a copy of memory
+// Returns its hash, computed from scratch, as memory_digest would be for it
+uint64_t hash_memory(const unsigned mem[]) {
+	uint64_t hash = 0;
+	for (size_t addr = 0; addr < MEM_SIZE; addr++)
+		hash ^= word_hash(addr, mem[addr]);
+	return hash;
+}
+
+// Takes an address below MEM_SIZE and a word
+// Stores the word in memory[], updating memory_digest
+inline void store_word(unsigned addr, unsigned value) {
+	memory_digest ^= word_hash(addr, memory[addr]) ^ word_hash(addr, value);
+	memory[addr] = value;
+}
+
+// Hardware prefetchers that can be attached to each cache with --prefetch
+enum Prefetcher { PF_NONE, PF_NEXTLINE, PF_STRIDE, PF_STREAM };
+
+// Entry of the PC-indexed table of the stride prefetcher
+struct StrideEntry {
+	int pc = -1;
+	int last_addr = 0;
+	int stride = 0;
+	int confidence = 0;		// 2-bit saturating counter
+};
+
+// Entry of the stream prefetcher table, following one run of sequential blocks
+struct StreamEntry {
+	bool valid = false;
+	int last_block = 0;
+	int direction = 0;		// +1 or -1
+	int confidence = 0;
+	long last_used = 0;
+};
+
+size_t const static STRIDE_TABLE_SIZE = 64;
+size_t const static STREAM_TABLE_SIZE = 8;
+
+// Inclusion property of a cache relative to the level above it.
+// NINE (non-inclusive non-exclusive) fills both levels and never back-invalidates.
+enum InclusionMode { MODE_NINE, MODE_INCLUSIVE, MODE_EXCLUSIVE };
+
+// Tag stored for a way that holds no block. Real tags are below MEM_SIZE, so they
+// never collide with it.
+uint16_t const static INVALID_TAG = 0xFFFF;
+
+// Takes the tags of the ways of one row, the associativity, and a tag
+// Returns the first way holding the tag, or -1 if none does
+int probe_scalar(const uint16_t *ways, int assoc, uint16_t tag) {
+	for (int i = 0; i < assoc; i++) {
+		if (ways[i] == tag)
+			return i;
+	}
+	return -1;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Compares eight ways per instruction, then finishes rows of fewer than eight ways
+// (or the tail of a wider row) with the scalar loop
+__attribute__((target("sse2")))
+int probe_sse2(const uint16_t *ways, int assoc, uint16_t tag) {
+	__m128i key = _mm_set1_epi16((short)tag);
+	int i = 0;
+	for (; i + 8 <= assoc; i += 8) {
+		__m128i row = _mm_loadu_si128((const __m128i *)(ways + i));
+		int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(row, key));
+		if (mask)
+			return i + __builtin_ctz(mask) / 2;
+	}
+	int way = probe_scalar(ways + i, assoc - i, tag);
+	return way == -1 ? -1 : i + way;
+}
+
+// Compares sixteen ways per instruction, which covers a whole 16-way row
+__attribute__((target("avx2")))
+int probe_avx2(const uint16_t *ways, int assoc, uint16_t tag) {
+	__m256i key = _mm256_set1_epi16((short)tag);
+	int i = 0;
+	for (; i + 16 <= assoc; i += 16) {
+		__m256i row = _mm256_loadu_si256((const __m256i *)(ways + i));
+		unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi16(row, key));
+		if (mask)
+			return i + __builtin_ctz(mask) / 2;
+	}
+	int way = probe_sse2(ways + i, assoc - i, tag);
+	return way == -1 ? -1 : i + way;
+}
+#endif
+
+// Probe used by every cache lookup. Chosen by choose_probe at startup.
+int (*tag_probe)(const uint16_t *, int, uint16_t) = probe_scalar;
+
+// Takes the name of a probe: "auto", "scalar", "sse2" or "avx2"
+// "auto" picks the widest one the host CPU supports.
+// Returns false if the name is unknown or the CPU cannot run that probe
+bool choose_probe(const string &name) {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	bool has_sse2 = __builtin_cpu_supports("sse2");
+	bool has_avx2 = __builtin_cpu_supports("avx2");
+#else
+	bool has_sse2 = false;
+	bool has_avx2 = false;
+#endif
+	if (name == "scalar" || (name == "auto" && !has_sse2))
+		tag_probe = probe_scalar;
+#if defined(__x86_64__) || defined(__i386__)
+	else if ((name == "avx2" && has_avx2) || (name == "auto" && has_avx2))
+		tag_probe = probe_avx2;
+	else if ((name == "sse2" && has_sse2) || name == "auto")
+		tag_probe = probe_sse2;
+#endif
+	else
+		return false;
+	return true;
+}
+
+// One block of a cache
+struct CacheLine {
+	bool valid = false;
+	bool dirty = false;
+	bool prefetched = false;	// filled by the prefetcher and not used by a demand access yet
+	bool exclusive = false;		// no other core holds the block (MESI state E, or M if dirty)
+	int tag = 0;
+};
+
+// Classes of a miss, from the shadow cache of the level that missed
+enum MissClass { MISS_COMPULSORY, MISS_CAPACITY, MISS_CONFLICT };
+
+// Misses of each class
+struct MissCounts {
+	long compulsory = 0;
+	long capacity = 0;
+	long conflict = 0;
+};
+
+// Fully-associative LRU cache with the capacity of a real one, used to tell capacity
+// misses from conflict misses, plus the set of blocks ever referenced.
+// The LRU list is linked through arrays indexed by block number, so an access is O(1).
+struct ShadowCache {
+	int blocksize = 1;
+	size_t capacity = 0;		// in blocks
+	size_t count = 0;			// blocks held
+	int head = -1;				// MRU block
+	int tail = -1;				// LRU block
+	vector<int> prev, next;		// neighbours of each held block in the LRU list
+	vector<bool> held;
+	vector<bool> seen;			// blocks referenced at least once
+
+	ShadowCache() {}
+	ShadowCache(int blocksize, size_t capacity) : blocksize(blocksize), capacity(capacity),
+		prev(MEM_SIZE / blocksize + 1), next(MEM_SIZE / blocksize + 1),
+		held(MEM_SIZE / blocksize + 1), seen(MEM_SIZE / blocksize + 1) {}
+
+	// Takes a block number and removes it from the LRU list
+	void unlink(int block) {
+		(prev[block] == -1 ? head : next[prev[block]]) = next[block];
+		(next[block] == -1 ? tail : prev[next[block]]) = prev[block];
+		held[block] = false;
+		count--;
+	}
+
+	// Takes a memory address and references its block, evicting the LRU block if full
+	// Returns the class the miss would have if the real cache missed
+	int access(unsigned pointer) {
+		int block = pointer / blocksize;
+		int kind = !seen[block] ? MISS_COMPULSORY : held[block] ? MISS_CONFLICT : MISS_CAPACITY;
+		seen[block] = true;
+		if (held[block])
+			unlink(block);
+		else if (count == capacity)
+			unlink(tail);
+
+		prev[block] = -1;
+		next[block] = head;
+		(head == -1 ? tail : prev[head]) = block;
+		head = block;
+		held[block] = true;
+		count++;
+		return kind;
+	}
+};
+
+// One level of the cache hierarchy: its geometry, policies, contents and statistics.
+// Lines are stored row by row, assoc lines to a row.
+struct CacheLevel {
+	string name;
+	int size = 0;
+	int assoc = 0;
+	int blocksize = 0;
+	int rows = 0;
+	// With blocksize and rows both powers of two, as in every standard geometry, an
+	// address is split with shifts and masks rather than / and %
+	bool power_of_two = false;
+	int offset_bits = 0;			// log2 of blocksize
+	int row_bits = 0;				// log2 of rows
+	unsigned row_mask = 0;			// rows - 1
+	bool write_back = false;		// false means write-through
+	bool write_allocate = true;		// false means no-write-allocate
+	int mode = MODE_NINE;			// inclusion relative to the level above
+
+	vector<CacheLine> lines;
+	vector<uint16_t> tags;			// tag of each line, INVALID_TAG if not valid, so a row can be probed at once
+	vector<vector<int>> blockdata;	// copy of the block of memory each line holds
+	vector<deque<int>> MRU;			// per row, line indices from LRU (front) to MRU (back)
+
+	int prefetcher = PF_NONE;
+	vector<StrideEntry> stride_table;
+	vector<StreamEntry> stream_table;
+
+	long read_hits = 0;
+	long read_misses = 0;
+	long write_hits = 0;
+	long write_misses = 0;
+	long writebacks = 0;			// dirty blocks evicted from this cache
+	long prefetches = 0;			// blocks filled by the prefetcher
+	long useful_prefetches = 0;		// prefetched blocks later hit by a demand access
+	long useless_prefetches = 0;	// prefetched blocks evicted before being used
+	long dropped_prefetches = 0;	// prefetches that found no free MSHR
+
+	// Used by --classify
+	ShadowCache shadow;
+	MissCounts miss_classes;
+	map<unsigned, MissCounts> pc_miss_classes;	// by pc of the access that missed
+
+	CacheLevel() {}
+	CacheLevel(const string &name, int size, int assoc, int blocksize) :
+		name(name), size(size), assoc(assoc), blocksize(blocksize),
+		rows(size / (assoc * blocksize)), lines(rows * assoc), tags(rows * assoc, INVALID_TAG),
+		blockdata(rows * assoc), MRU(rows) {
+		power_of_two = (blocksize & (blocksize - 1)) == 0 && (rows & (rows - 1)) == 0;
+		if (power_of_two) {
+			offset_bits = __builtin_ctz(blocksize);
+			row_bits = __builtin_ctz(rows);
+			row_mask = rows - 1;
+		}
+	}
+
+	// Takes a memory address and returns the number of the block holding it
+	unsigned block_of(unsigned pointer) const {
+		return power_of_two ? pointer >> offset_bits : pointer / blocksize;
+	}
+
+	// Takes a memory address and returns the row it maps to
+	int row_of(unsigned pointer) const {
+		return power_of_two ? (pointer >> offset_bits) & row_mask : (pointer / blocksize) % rows;
+	}
+
+	// Takes a memory address and returns the tag stored for it
+	int tag_of(unsigned pointer) const {
+		return power_of_two ? pointer >> (offset_bits + row_bits) : (pointer / blocksize) / rows;
+	}
+
+	// Takes a memory address and returns its position within its block
+	int offset_of(unsigned pointer) const {
+		return power_of_two ? pointer & (blocksize - 1) : pointer % blocksize;
+	}
+
+	// Takes the index of a line and returns the address of the first word of its block
+	unsigned block_address(int index) const {
+		return (lines[index].tag * rows + index / assoc) * blocksize;
+	}
+
+	// Takes a memory address
+	// Returns the index of the valid line holding it, or -1 if it is not cached
+	int find(unsigned pointer) const {
+		int row = row_of(pointer);
+		int way = tag_probe(&tags[row * assoc], assoc, tag_of(pointer));
+		return way == -1 ? -1 : row * assoc + way;
+	}
+
+	// Takes a row
+	// Returns the index of its first invalid line, or -1 if the row is full
+	int find_free(int row) const {
+		int way = tag_probe(&tags[row * assoc], assoc, INVALID_TAG);
+		return way == -1 ? -1 : row * assoc + way;
+	}
+
+	// Takes the index of a line that was just accessed
+	// Moves it to the MRU (rightmost) end of its row's deque, removing any duplicate,
+	// so that the LRU line is at the leftmost end
+	void touch(int index) {
+		deque<int> &rowMRU = MRU[index / assoc];
+		rowMRU.erase(remove(rowMRU.begin(), rowMRU.end(), index), rowMRU.end());
+		rowMRU.push_back(index);
+		if (rowMRU.size() > assoc)
+			rowMRU.pop_front();
+	}
+
+	// Takes the index of a line
+	// Marks the line invalid and removes it from its row's deque
+	void invalidate(int index) {
+		deque<int> &rowMRU = MRU[index / assoc];
+		lines[index] = CacheLine();
+		tags[index] = INVALID_TAG;
+		rowMRU.erase(remove(rowMRU.begin(), rowMRU.end(), index), rowMRU.end());
+	}
+
+	// Takes a memory address
+	// Returns a copy of the block of memory that holds it
+	vector<int> read_block(unsigned pointer) const;
+};
+
+// Set by --tag-only: lines keep only their tag and replacement state, not a copy of
+// their block. memory[] always holds the latest values, so loads read it instead.
+bool tag_only = false;
+
+vector<CacheLevel> levels;	// the cache hierarchy, levels[0] is L1
+
+// Traffic between the last cache level and memory, measured in words
+long mem_words_read = 0;
+long mem_words_written = 0;
+
+// Number of the cache that served the last load, or 0 if it came from memory
+int last_read_level = 0;
+long back_invalidations = 0;
+
+// Entry of the fully-associative victim cache behind L1, holding one evicted L1 block.
+// Its data is always read back from memory[], which holds the latest values.
+struct VictimEntry {
+	bool valid = false;
+	unsigned block_addr = 0;
+	bool dirty = false;
+	long last_used = 0;
+};
+
+vector<VictimEntry> victim_cache;	// empty unless --victim is given
+long victim_clock = 0;				// ages entries for LRU replacement
+long victim_hits = 0;
+long victim_misses = 0;
+bool last_read_victim = false;		// the last load hit in the victim cache
+
+// Coherence protocols between the private L1s of multiple cores, set with --coherence
+enum Coherence { COHERENCE_MSI, COHERENCE_MESI };
+
+// State of one simulated core, enabled with --cores. Each core has its own pc,
+// registers, L1 and victim cache; every level below L1 and memory[] are shared.
+// The running core's pc, registers, L1 and victim cache live in the globals,
+// and switch_core swaps them with the copies saved here.
+struct Core {
+	unsigned pc = 0;
+	unsigned registers[NUM_REGS] = {};
+	bool halted = false;
+	CacheLevel L1;
+	vector<VictimEntry> victim_cache;
+
+	unordered_set<unsigned> invalidated;	// L1 blocks lost to other cores' writes
+	long instructions = 0;
+	long coherence_misses = 0;		// L1 misses on blocks lost to other cores' writes
+	long invalidations = 0;			// copies invalidated by other cores' writes
+	long upgrades = 0;				// writes to shared blocks that had to claim them
+	long flushes = 0;				// modified blocks written back for other cores
+
+	// Used when the cores run on host threads
+	unordered_map<unsigned, unsigned> store_buffer;	// stores of the current quantum
+	long step = 0;					// instruction number within the quantum
+};
+
+vector<Core> cores;		// empty unless --cores is given
+size_t current_core = 0;	// cores.size() while no core is running
+int coherence = COHERENCE_MESI;
+
+// Memory access of a core running on its own host thread, replayed through
+// the shared levels by the coordinator at the end of the quantum
+struct CoreEvent {
+	long step;			// instruction number within the quantum
+	unsigned pc;
+	unsigned addr;
+	unsigned value;		// value stored, for stores
+	bool store;
+	bool handled;		// the core's L1 already handled the access on its thread
+};
+
+// Single-producer single-consumer ring of the events of one core. The core's thread
+// pushes while it runs a quantum and the coordinator pops after the barrier, so
+// neither side takes a lock. It holds a whole quantum, one event per instruction at most.
+struct EventQueue {
+	vector<CoreEvent> ring;
+	atomic<size_t> head{0};		// next event to pop
+	atomic<size_t> tail{0};		// next free slot
+
+	// Takes the largest number of events queued at once
+	void reserve(size_t capacity) {
+		size_t size = 1;
+		while (size < capacity)
+			size *= 2;
+		ring.resize(size);
+	}
+
+	void push(const CoreEvent &event) {
+		size_t t = tail.load(memory_order_relaxed);
+		ring[t & (ring.size() - 1)] = event;
+		tail.store(t + 1, memory_order_release);
+	}
+
+	// Returns a pointer to the oldest event, or nullptr if the queue is empty
+	const CoreEvent *front() const {
+		size_t h = head.load(memory_order_relaxed);
+		if (h == tail.load(memory_order_acquire))
+			return nullptr;
+		return &ring[h & (ring.size() - 1)];
+	}
+
+	void pop() {
+		head.store(head.load(memory_order_relaxed) + 1, memory_order_release);
+	}
+};
+
+// Reusable barrier for a fixed number of threads
+struct Barrier {
+	mutex m;
+	condition_variable cv;
+	int count;
+	int waiting = 0;
+	long generation = 0;
+
+	Barrier(int count) : count(count) {}
+
+	void wait() {
+		unique_lock<mutex> lock(m);
+		long gen = generation;
+		if (++waiting == count) {
+			waiting = 0;
+			generation++;
+			cv.notify_all();
+		} else
+			cv.wait(lock, [&] { return gen != generation; });
+	}
+};
+
+deque<EventQueue> event_queues;				// one per core
+thread_local Core *parallel_core = nullptr;	// core run by this thread during a quantum
+int num_threads = 0;		// host threads running the cores, 0 to run them on the main thread
+long quantum = 1000;		// instructions each core runs between barriers
+long quanta = 0;
+double parallel_seconds = 0;
+
+// Single-producer single-consumer ring between the stages of --host-pipeline. Unlike
+// EventQueue it runs for the whole simulation, so a full ring makes the producer
+// wait and an empty one the consumer. Each side only publishes its position every
+// BATCH items, or before it waits, so the two threads rarely touch the same cache line.
+template <typename T>
+struct PipeRing {
+	static const size_t BATCH = 64;
+	vector<T> ring;
+	alignas(64) atomic<size_t> head{0};		// items popped, as last published
+	alignas(64) atomic<size_t> tail{0};		// items pushed, as last published
+	alignas(64) size_t pushed = 0;			// the producer's own count
+	size_t head_seen = 0;
+	alignas(64) size_t popped = 0;			// the consumer's own count
+	size_t tail_seen = 0;
+
+	// Takes the number of items the ring holds, a multiple of BATCH
+	PipeRing(size_t capacity) : ring(capacity) {}
+
+	void push(T &&item) {
+		if (pushed - head_seen == ring.size()) {
+			tail.store(pushed, memory_order_release);
+			while ((head_seen = head.load(memory_order_acquire)) + ring.size() == pushed)
+				this_thread::yield();
+		}
+		ring[pushed % ring.size()] = move(item);
+		if (++pushed % BATCH == 0)
+			tail.store(pushed, memory_order_release);
+	}
+
+	// Publishes the items pushed since the last batch
+	void flush() {
+		tail.store(pushed, memory_order_release);
+	}
+
+	// Returns the oldest item, waiting for one if the ring is empty
+	T &front() {
+		if (popped == tail_seen) {
+			head.store(popped, memory_order_release);
+			while ((tail_seen = tail.load(memory_order_acquire)) == popped)
+				this_thread::yield();
+		}
+		return ring[popped % ring.size()];
+	}
+
+	void pop() {
+		if (++popped % BATCH == 0)
+			head.store(popped, memory_order_release);
+	}
+};
+
+// Memory reference passed from the interpreter to the cache model by --host-pipeline
+enum ReferenceKind : unsigned char { REF_LOAD, REF_STORE, REF_INVALID, REF_END };
+struct MemoryReference {
+	unsigned pc;
+	unsigned addr;
+	unsigned value;		// value stored, for stores
+	ReferenceKind kind;	// REF_INVALID reports an invalid instruction at pc
+};
+
+// Log entry passed from the cache model to the log writer by --host-pipeline, or a
+// LOG_INVALID report of an invalid instruction at pc. It holds no strings, so queueing
+// it copies no text; the writer names the cache from levels.
+enum LogRecordKind : unsigned char { LOG_ENTRY, LOG_INVALID, LOG_END };
+struct LogRecord {
+	LogRecordKind kind;
+	LogStatus status;
+	unsigned char level;	// index in levels of the cache
+	bool victim;			// the entry is for the victim cache behind levels[level]
+	int pc;
+	int addr;
+	int row;
+	const char *detail;		// a string literal, such as the class of a miss
+};
+
+PipeRing<MemoryReference> reference_ring(1 << 12);
+PipeRing<LogRecord> log_ring(1 << 12);
+
+// Prefetches queued by the last load as (level, address) pairs.
+// They are issued after the load so its timing only covers the demand access.
+vector<pair<size_t, unsigned>> pending_prefetches;
+int prefetch_degree = 1;	// blocks fetched ahead of each trigger
+long prefetch_clock = 0;	// ages stream table entries for LRU replacement
+
+// Optional cycle model of the memory hierarchy, enabled with --timing.
+// Every instruction takes one cycle; loads stall for the latency of the level
+// that serves them, and stores are posted so they only stall for a free MSHR.
+struct TimingModel {
+	bool enabled = false;
+	vector<int> latency;			// hit latency of each cache, then DRAM latency
+	int dram_cycles_per_word = 1;	// DRAM bandwidth
+	vector<long> mshr_free_at = vector<long>(4, 0);	// cycle each MSHR frees up
+
+	long cycles = 0;
+	long instructions = 0;
+	long dram_free_at = 0;			// cycle the DRAM channel frees up
+	long mem_accesses = 0;
+	long mem_access_cycles = 0;
+
+	vector<long> level_stalls;		// stall cycles in each cache, then in DRAM
+	long queue_stalls = 0;			// waiting for the DRAM channel
+	long mshr_stalls = 0;			// waiting for a free MSHR
+};
+
+TimingModel timing;
 
 // Define global opcodes
 const unsigned op_add = 0;		// 000
@@ -99,9 +673,10 @@ const unsigned op_jal = 3;		// 011
 
 	@param f Open file to read from
 	@param mem Array represetnting memory into which to read program
+	@param comments If given, gets the comment after each word, without the //
 */
-void load_machine_code(ifstream &f, unsigned mem[]) {
-	regex machine_code_re("^ram\\[(\\d+)\\] = 16'b(\\d+);.*$");
+size_t load_machine_code(ifstream &f, unsigned mem[], vector<string> *comments = nullptr) {
+	regex machine_code_re("^ram\\[(\\d+)\\] = 16'b(\\d+);(.*)$");
 	size_t expectedaddr = 0;
 	string line;
 	while (getline(f, line)) {
@@ -122,39 +697,49 @@ void load_machine_code(ifstream &f, unsigned mem[]) {
 		}
 		expectedaddr ++;
 		mem[addr] = instr;
+		if (comments != nullptr) {
+			// The assembler follows each word with its source as a // comment
+			string comment = sm[3];
+			size_t start = comment.find("// ");
+			comments->push_back((start == string::npos) ? "" : comment.substr(start + 3));
+		}
 	}
+	return expectedaddr;
 }
 
 /*
 	Prints the current state of the simulator, including
 	the current program counter, the current register values,
 	and the first memquantity elements of memory.
+	The dump is formatted into one buffer and written at once,
+	so that all of memory can be printed quickly.
 
 	@param pc The final value of the program counter
 	@param regs Final value of all registers
 	@param memory Final value of memory
 	@param memquantity How many words of memory to dump
 */
-void print_state(unsigned pc, unsigned regs[], unsigned memory[], size_t memquantity) {
-	cout << setfill(' ');
-	cout << "Final state:" << endl;
-	cout << "\tpc=" <<setw(5)<< pc << endl;
-
-	for (size_t reg=0; reg<NUM_REGS; reg++)
-		cout << "\t$" << reg << "="<<setw(5)<<regs[reg]<<endl;
+void print_state(unsigned pc, const unsigned regs[], const unsigned memory[], size_t memquantity) {
+	const char *hex_digits = "0123456789abcdef";
+	string out = "Final state:\n";
+	out.reserve(out.size() + 11 * (NUM_REGS + 1) + 5 * memquantity + 1);
+	char line[32];
+	snprintf(line, sizeof(line), "\tpc=%5u\n", pc);
+	out += line;
+	for (size_t reg=0; reg<NUM_REGS; reg++) {
+		snprintf(line, sizeof(line), "\t$%zu=%5u\n", reg, regs[reg]);
+		out += line;
+	}
 
-	cout << setfill('0');
-	bool cr = false;
 	for (size_t count=0; count<memquantity; count++) {
-		cout << hex << setw(4) << memory[count] << " ";
-		cr = true;
-		if (count % 8 == 7) {
-			cout << endl;
-			cr = false;
-		}
+		unsigned word = memory[count];	// words are 16 bits, so 4 hex digits
+		char text[6] = {hex_digits[(word >> 12) & 15], hex_digits[(word >> 8) & 15],
+			hex_digits[(word >> 4) & 15], hex_digits[word & 15], ' ', '\n'};
+		out.append(text, (count % 8 == 7) ? 6 : 5);
 	}
-	if (cr)
-		cout << endl;
+	if (memquantity % 8 != 0)
+		out += '\n';
+	cout.write(out.data(), out.size());
 }
 
 // Takes an unsigned int representing an E20 instruction
@@ -193,379 +778,1899 @@ void set_pc(int new_pc) {
 		pc %= MEM_SIZE;
 }
 
-// Takes an int representing L1 or L2 cache, an int representing the row that we're considering,
-// an int indicating the block that was accessed, and another int indicating
-// the associativity of cache the deque corresponds to.
-// Function will update the deque by pushing MRU data to rightmost side of deque
-// while also removing any duplicates of it currently in the deque.
-// This means that the LRU data is at the leftmost side of the deque
-void updateMRU(int cache_num, int row, int block_in_row, int assoc) {
-	if (cache_num == 1) {
-		// Remove duplicate
-		for (auto it = L1MRU[row].begin(); it != L1MRU[row].end();) {
-			if (*it == block_in_row)
-				it = L1MRU[row].erase(it);
-			else
-				it++;
-		}
-
-		// Push back newly accessed data
-		L1MRU[row].push_back(block_in_row);
+vector<int> CacheLevel::read_block(unsigned pointer) const {
+	unsigned start = pointer - offset_of(pointer);
 
-		// If deque has more elements than possible, pop first element
-		if (L1MRU[row].size() > assoc)
-			L1MRU[row].pop_front();
-	} else if (cache_num == 2) {
-		for (auto it = L2MRU[row].begin(); it != L2MRU[row].end();) {
-			if (*it == block_in_row)
-				it = L2MRU[row].erase(it);
-			else
-				it++;
-		}
+	vector<int> blockdata;
+	for (size_t i = 0; i < blocksize; i++)
+		blockdata.push_back(model_memory[start + i]);
 
-		L2MRU[row].push_back(block_in_row);
+	return blockdata;
+}
 
-		if (L2MRU[row].size() > assoc)
-			L2MRU[row].pop_front();
-	} else {
-		cout << "Not a valid cache" << endl;
+// Takes a memory address and optionally the victim cache of a core that is not running
+// Returns the index of the victim cache entry holding its L1 block, or -1 if there is none
+int find_victim(unsigned pointer, const vector<VictimEntry> &victims = victim_cache) {
+	unsigned block_addr = (pointer / levels[0].blocksize) * levels[0].blocksize;
+	for (size_t i = 0; i < victims.size(); i++) {
+		if (victims[i].valid && victims[i].block_addr == block_addr)
+			return i;
 	}
+	return -1;
 }
 
-// Takes an unsigned int representing an E20 instruction
-// Returns true if the instruction executed is halt
-// Performs the instruction and updates the global pc and registers variable accordingly
-bool execute_instruction(unsigned instruction, int blocks1, int assoc1, int blocks2 = 0, int assoc2 = 0) {
-	unsigned op_code = find_opcode(instruction);
-	unsigned regSrcA;
-	unsigned regSrcB;
-	unsigned regDst;
-	int imm;
-	// cout << "pc: " << pc << endl;
+// Takes the L1 of a core and returns the name of its victim cache for log entries
+string victim_name(const CacheLevel &L1) {
+	return "VC" + L1.name.substr(2);
+}
 
-	if (op_code == op_add && ((instruction & 15) == 0)) {	// check opcode and least sig 4 bits
-		regSrcA = (instruction >> 10) & 7;	// isolate least significant 3 bits
-		regSrcB = (instruction >> 7) & 7;
-		regDst = (instruction >> 4) & 7;
+// Takes the fields of a log entry
+// Prints it as print_log_entry describes
+void write_log_entry(const string &cache_name, LogStatus status, int pc, int addr, int row,
+		const char *detail) {
+	cout << left << setw(8) << cache_name + " " + LOG_STATUS_NAMES[status] <<  right <<
+		" pc:" << setw(5) << pc <<
+		"\taddr:" << setw(5) << addr <<
+		"\trow:" << setw(4) << row;
+	if (detail[0] != '\0')
+		cout << "\t" << detail;
+	cout << endl;
+}
 
-		if (regDst != 0)	// if we are not modifying register 0
-			registers[regDst] = (registers[regSrcA] + registers[regSrcB]) & 65535;	// trim result to 16 bits
+/*
+	Prints out a correctly-formatted log entry.
 
-		increment_pc();
-		return false;
-	}
+	@param cache The cache where the event occurred,
+		named in the entry. "L1" or "L2"
 
-	else if (op_code == op_sub && ((instruction & 15) == 1)) {
-		regSrcA = (instruction >> 10) & 7;
-		regSrcB = (instruction >> 7) & 7;
-		regDst = (instruction >> 4) & 7;
+	@param victim Whether the event occurred in the
+		victim cache behind cache instead
 
-		if (regDst != 0)
-			registers[regDst] = (registers[regSrcA] - registers[regSrcB]) & 65535;
+	@param status The kind of cache event. LOG_SW, LOG_HIT,
+		LOG_MISS, or LOG_WB (a dirty block written back on eviction)
 
-		increment_pc();
-		return false;
-	}
+	@param pc The program counter of the memory
+		access instruction
 
-	else if (op_code == op_or && ((instruction & 15) == 2)) {
-		regSrcA = (instruction >> 10) & 7;
-		regSrcB = (instruction >> 7) & 7;
-		regDst = (instruction >> 4) & 7;
+	@param addr The memory address being accessed.
 
-		if (regDst != 0)
-			registers[regDst] = (registers[regSrcA] | registers[regSrcB]) & 65535;
+	@param row The cache row or set number where the data
+		is stored.
 
-		increment_pc();
-		return false;
-	}
+	@param detail Optional extra column, such as the class of a miss
+*/
+void print_log_entry(const CacheLevel &cache, bool victim, LogStatus status, int pc, int addr, int row,
+		const char *detail = "") {
+	if (record_cache_events)
+		cache_events.push_back({victim ? victim_name(cache) : cache.name, LOG_STATUS_NAMES[status], pc, addr, row});
+	if (!log_enabled)
+		return;
+	if (host_pipeline) {
+		unsigned char level = &cache - levels.data();
+		log_ring.push({LOG_ENTRY, status, level, victim, pc, addr, row, detail});
+	} else if (victim)
+		write_log_entry(victim_name(cache), status, pc, addr, row, detail);
+	else
+		write_log_entry(cache.name, status, pc, addr, row, detail);
+}
 
-	else if (op_code == op_and && ((instruction & 15) == 3)) {
-		regSrcA = (instruction >> 10) & 7;
-		regSrcB = (instruction >> 7) & 7;
-		regDst = (instruction >> 4) & 7;
+// Takes the number of a core and returns a reference to its L1,
+// which is levels[0] for the running core
+CacheLevel &core_L1(size_t id) {
+	return (id == current_core) ? levels[0] : cores[id].L1;
+}
 
-		if (regDst != 0)
-			registers[regDst] = (registers[regSrcA] & registers[regSrcB]) & 65535;
+// Takes the number of a core and returns a reference to its victim cache
+vector<VictimEntry> &core_victims(size_t id) {
+	return (id == current_core) ? victim_cache : cores[id].victim_cache;
+}
 
-		increment_pc();
-		return false;
+// Takes the number of a core, or cores.size() to leave no core running
+// Saves the state of the running core and makes the given core the running one
+void switch_core(size_t id) {
+	if (id == current_core)
+		return;
+
+	if (current_core < cores.size()) {
+		Core &old = cores[current_core];
+		old.pc = pc;
+		copy(begin(registers), end(registers), begin(old.registers));
+		swap(old.L1, levels[0]);
+		swap(old.victim_cache, victim_cache);
 	}
 
-	else if (op_code == op_slt && ((instruction & 15) == 4)) {
-		regSrcA = (instruction >> 10) & 7;
-		regSrcB = (instruction >> 7) & 7;
-		regDst = (instruction >> 4) & 7;
+	current_core = id;
+	if (id == cores.size())
+		return;
 
-		if (regDst != 0) {
-			if (registers[regSrcA] < registers[regSrcB])
-				registers[regDst] = 1;
-			else
-				registers[regDst] = 0;
-		}
+	Core &next = cores[id];
+	pc = next.pc;
+	copy(begin(next.registers), end(next.registers), begin(registers));
+	swap(next.L1, levels[0]);
+	swap(next.victim_cache, victim_cache);
+}
 
-		increment_pc();
+// Takes a level and a memory address
+// Returns true if the level above it, or the victim cache behind L1, holds the address
+bool held_above(size_t level, unsigned pointer) {
+	if (level == 0)
 		return false;
-	}
+	if (levels[level - 1].find(pointer) != -1)
+		return true;
+	return level == 1 && victim_cache.size() > 0 && find_victim(pointer) != -1;
+}
 
-	else if (op_code == op_jr && ((instruction & 15) == 8)) {
-		regSrcA = (instruction >> 10) & 7;
-		set_pc(registers[regSrcA]);
-		return false;
+// Takes the first level below a block's cache, the address of the block and its size in words
+// Passes a writeback down the hierarchy: the first write-back level holding the block
+// absorbs it, write-through levels holding it pass it on, and otherwise it reaches memory.
+// Writebacks never allocate.
+void write_block_down(size_t level, unsigned block_addr, int words) {
+	for (; level < levels.size(); level++) {
+		CacheLevel &cache = levels[level];
+		int index = cache.find(block_addr);
+		if (index == -1)
+			continue;
+
+		// memory[] always holds the latest values, so refresh the copy from it
+		if (!tag_only)
+			cache.blockdata[index] = cache.read_block(block_addr);
+		if (cache.write_back) {
+			cache.lines[index].dirty = true;
+			return;
+		}
 	}
+	mem_words_written += words;
+}
 
-	else if (op_code == op_slti) {
-		regSrcA = (instruction >> 10) & 7;
-		regDst = (instruction >> 7) & 7;
-		imm = instruction & 127;	// isolate least significant 7 bits
-
-		if (imm > 63)			// if 7th most sig bit is 1, then
-			imm = imm | 65408;	// sign extend 7 bit immediate to 16 bits (using 1111111110000000 mask)
+void back_invalidate(size_t level, unsigned block_addr);
+
+// Takes an inclusive level, the address of a block that is leaving it, and the level
+// above it with its victim cache (only used when the level above is an L1)
+// Invalidates every copy of the block above, logging an "INV" entry for each.
+// Dirty copies are written back past this level since it no longer holds the block.
+void back_invalidate_copies(size_t level, unsigned block_addr, CacheLevel &above, vector<VictimEntry> &victims) {
+	for (unsigned addr = block_addr; addr < block_addr + levels[level].blocksize; addr += above.blocksize) {
+		int index = above.find(addr);
+		if (index != -1) {
+			if (above.lines[index].dirty)
+				write_block_down(level + 1, addr, above.blocksize);
+			back_invalidations++;
+			print_log_entry(above, false, LOG_INV, pc, addr, index / above.assoc);
+			above.invalidate(index);
+			if (level - 1 > 0 && above.mode == MODE_INCLUSIVE)
+				back_invalidate(level - 1, addr);
+		}
 
-		if (regDst != 0) {
-			if (registers[regSrcA] < imm)
-				registers[regDst] = 1;
-			else
-				registers[regDst] = 0;
+		int entry = (level == 1) ? find_victim(addr, victims) : -1;
+		if (entry != -1) {
+			if (victims[entry].dirty)
+				write_block_down(level + 1, addr, above.blocksize);
+			back_invalidations++;
+			print_log_entry(above, true, LOG_INV, pc, addr, entry);
+			victims[entry].valid = false;
 		}
+	}
+}
 
-		increment_pc();
-		return false;
+// Takes an inclusive level and the address of a block that is leaving it
+// Back-invalidates the copies in the level above, which for L2 means the L1
+// and victim cache of every core
+void back_invalidate(size_t level, unsigned block_addr) {
+	if (level == 1 && cores.size() > 1) {
+		for (size_t id = 0; id < cores.size(); id++)
+			back_invalidate_copies(level, block_addr, core_L1(id), core_victims(id));
+	} else
+		back_invalidate_copies(level, block_addr, levels[level - 1], victim_cache);
+}
+
+// Takes the number of a core that is not running and a memory address
+// Writes the core's modified copy of the address's L1 block back down the hierarchy
+// for another core, logging a "WB" entry. Does nothing if the core's copy is clean.
+void flush_copy(size_t id, unsigned pointer) {
+	CacheLevel &L1 = cores[id].L1;
+	int index = L1.find(pointer);
+	int entry = find_victim(pointer, cores[id].victim_cache);
+	unsigned block_addr = pointer - L1.offset_of(pointer);
+
+	if (index != -1 && L1.lines[index].dirty) {
+		L1.lines[index].dirty = false;
+		print_log_entry(L1, false, LOG_WB, pc, block_addr, index / L1.assoc);
+	} else if (entry != -1 && cores[id].victim_cache[entry].dirty) {
+		cores[id].victim_cache[entry].dirty = false;
+		print_log_entry(L1, true, LOG_WB, pc, block_addr, entry);
+	} else
+		return;
+
+	cores[id].flushes++;
+	write_block_down(1, block_addr, L1.blocksize);
+}
+
+// Takes a memory address whose L1 block the running core is about to fill
+// Snoops the other cores: modified copies are flushed and every copy becomes shared.
+// Returns true if any other core holds the block
+bool snoop_read(unsigned pointer) {
+	bool shared = false;
+	for (size_t id = 0; id < cores.size(); id++) {
+		if (id == current_core)
+			continue;
+
+		CacheLevel &L1 = cores[id].L1;
+		int index = L1.find(pointer);
+		int entry = find_victim(pointer, cores[id].victim_cache);
+		if (index == -1 && entry == -1)
+			continue;
+
+		shared = true;
+		flush_copy(id, pointer);
+		if (index != -1)
+			L1.lines[index].exclusive = false;
 	}
+	return shared;
+}
 
-	else if (op_code == op_lw) {
-		regSrcA = (instruction >> 10) & 7;
-		regDst = (instruction >> 7) & 7;
-		imm = instruction & 127;
+// Takes a memory address the running core is about to store to
+// Unless the core's L1 already holds the block exclusively, invalidates the copies
+// of every other core, logging an "INV" entry for each. Modified copies are flushed first.
+void snoop_write(unsigned pointer) {
+	CacheLevel &own = levels[0];
+	int own_index = own.find(pointer);
+	if (own_index != -1 && own.lines[own_index].exclusive)
+		return;
+	if (own_index != -1)
+		cores[current_core].upgrades++;
+
+	unsigned block_addr = (pointer / own.blocksize) * own.blocksize;
+	for (size_t id = 0; id < cores.size(); id++) {
+		if (id == current_core)
+			continue;
+
+		CacheLevel &L1 = cores[id].L1;
+		int index = L1.find(pointer);
+		int entry = find_victim(pointer, cores[id].victim_cache);
+		if (index == -1 && entry == -1)
+			continue;
+
+		flush_copy(id, pointer);
+		if (index != -1) {
+			print_log_entry(L1, false, LOG_INV, pc, block_addr, index / L1.assoc);
+			L1.invalidate(index);
+		}
+		if (entry != -1) {
+			print_log_entry(L1, true, LOG_INV, pc, block_addr, entry);
+			cores[id].victim_cache[entry].valid = false;
+		}
+		cores[id].invalidations++;
+		cores[id].invalidated.insert(block_addr);
+	}
+}
 
-		if (imm > 63)	// if 7th most sig bit is 1, then negate
-			imm = to_signed_binary(imm);
+// Takes a memory address that missed in the running core's L1
+// Counts a coherence miss if another core's write took the block away
+void note_L1_miss(unsigned pointer) {
+	if (cores.size() <= 1)
+		return;
 
-		unsigned pointer = (registers[regSrcA] + imm) & 8191;	// only care about least sig 13 bits
-		// mask will ensure the pointer points to a valid memory address (it will always be < 8192)
+	unsigned block_addr = (pointer / levels[0].blocksize) * levels[0].blocksize;
+	if (cores[current_core].invalidated.erase(block_addr) > 0)
+		cores[current_core].coherence_misses++;
+}
 
-		/*Start of cache simulation*/
-		string status = "";
-		int L1row = (pointer / blocks1) % (L1cache.size() / assoc1); // L1cache.size() / assoc1 = number of rows
-		int L1tag = (pointer / blocks1) / (L1cache.size() / assoc1);
+int place_block(size_t level, unsigned pointer);
+int allocate_block(size_t level, unsigned pointer);
+
+// Takes a level, the address of a block that has left it (and the victim cache, for L1),
+// whether it is dirty, whether it left the victim cache, and the row it left (for the
+// "WB" log entry).
+// If the next level is exclusive the block moves into it. Otherwise a dirty block is
+// written back down the hierarchy.
+void retire_block(size_t level, unsigned block_addr, bool dirty, bool victim, int row) {
+	CacheLevel &cache = levels[level];
+	if (dirty) {
+		cache.writebacks++;
+		print_log_entry(cache, victim, LOG_WB, pc, block_addr, row);
+	}
 
-		// Check if hit in L1 cache
-		for (size_t i = 0; i < assoc1; i++) {
-			if (L1cache[L1row * assoc1 + i][1] != 0) {
-				if (L1cache[L1row * assoc1 + i][2] == L1tag) {	// If tag is equal
-					status = "HIT";
-					print_log_entry("L1", status, pc, pointer, L1row);
+	if (level + 1 < levels.size() && levels[level + 1].mode == MODE_EXCLUSIVE) {
+		// An inclusive level below the exclusive one must hold the block first
+		if (level + 2 < levels.size() && levels[level + 2].mode == MODE_INCLUSIVE && levels[level + 2].find(block_addr) == -1)
+			allocate_block(level + 2, block_addr);
+
+		CacheLevel &next = levels[level + 1];
+		int index = place_block(level + 1, block_addr);
+		if (dirty && next.write_back)
+			next.lines[index].dirty = true;
+		else if (dirty)
+			write_block_down(level + 2, block_addr, cache.blocksize);
+		return;
+	}
 
-					if (regDst != 0)
-						registers[regDst] = L1blockdata[L1row * assoc1 + i][pointer % blocks1];	// Fetch data from cache
+	if (dirty)
+		write_block_down(level + 1, block_addr, cache.blocksize);
+}
 
-					updateMRU(1, L1row, L1row * assoc1 + i, assoc1);
-					increment_pc();
-					return false;
-				}
-			}
+// Takes the address of a block evicted from L1 and whether it is dirty
+// Puts it in the victim cache, replacing the LRU entry, whose block is retired
+void insert_victim(unsigned block_addr, bool dirty) {
+	int slot = 0;
+	for (size_t i = 0; i < victim_cache.size(); i++) {
+		if (!victim_cache[i].valid) {
+			slot = i;
+			break;
 		}
+		if (victim_cache[i].last_used < victim_cache[slot].last_used)
+			slot = i;
+	}
 
-		// No hits in L1 cache, so print miss log entry for L1 cache
-		status = "MISS";
-		print_log_entry("L1", status, pc, pointer, L1row);
+	VictimEntry &entry = victim_cache[slot];
+	if (entry.valid)
+		retire_block(0, entry.block_addr, entry.dirty, true, slot);
 
-		// Now check L2 cache (if available) for any hits
-		if (blocks2 != 0) {
-			int L2row = (pointer / blocks2) % (L2cache.size() / assoc2);
-			int L2tag = (pointer / blocks2) / (L2cache.size() / assoc2);
+	entry.valid = true;
+	entry.block_addr = block_addr;
+	entry.dirty = dirty;
+	entry.last_used = ++victim_clock;
+}
 
-			// Check if hit in L2 cache
-			for (size_t i = 0; i < assoc2; i++) {
-				if (L2cache[L2row * assoc2 + i][1] != 0) {
-					if (L2cache[L2row * assoc2 + i][2] == L2tag) {
-						status = "HIT";
-						print_log_entry("L2", status, pc, pointer, L2row);
+// Takes a level and the index of a line that is being replaced
+// L1 blocks move to the victim cache if there is one. Every other block is retired
+// to the next level, and an inclusive level back-invalidates the copies above it.
+void evict_block(size_t level, int index) {
+	CacheLevel &cache = levels[level];
+	CacheLine &line = cache.lines[index];
+	if (!line.valid)
+		return;
+
+	unsigned block_addr = cache.block_address(index);
+	int row = index / cache.assoc;
+	bool dirty = line.dirty;
+	if (line.prefetched)
+		cache.useless_prefetches++;
+	cache.invalidate(index);
+
+	if (level == 0 && victim_cache.size() > 0)
+		insert_victim(block_addr, dirty);
+	else
+		retire_block(level, block_addr, dirty, false, row);
+
+	if (level > 0 && cache.mode == MODE_INCLUSIVE)
+		back_invalidate(level, block_addr);
+}
 
-						if (regDst != 0)
-							registers[regDst] = L2blockdata[L2row * assoc2 + i][pointer % blocks2];
+// Takes a level and a memory address
+// Places the block holding the address into a free line of its row, or into the
+// LRU line if the row is full, evicting the old block.
+// Returns the index of the placed line
+int place_block(size_t level, unsigned pointer) {
+	CacheLevel &cache = levels[level];
+	int row = cache.row_of(pointer);
+
+	// Check for free lines in the row
+	int index = cache.find_free(row);
+
+	// If no free lines, evict the LRU line
+	if (index == -1) {
+		index = cache.MRU[row].front();
+		evict_block(level, index);
+	}
 
-						updateMRU(2, L2row, L2row * assoc2 + i, assoc2);
-						increment_pc();
-						return false;
-					}
-				}
-			}
+	cache.lines[index].valid = true;
+	cache.lines[index].tag = cache.tag_of(pointer);
+	cache.tags[index] = cache.tag_of(pointer);
+	if (!tag_only)
+		cache.blockdata[index] = cache.read_block(pointer);
+	cache.touch(index);
+	return index;
+}
 
-			// No hits in L2 cache, so print miss log entry for L2 cache
-			print_log_entry("L2", status, pc, pointer, L2row);
-		}
+// Takes a level, a memory address the level above is filling, and the size in words
+// of the block being filled. Supplies the block: an exclusive level hands it over if
+// it holds it (or passes the request on), other levels allocate it if they miss,
+// and past the last level it is read from memory.
+// Returns true if the block handed over was dirty
+bool fetch_block(size_t level, unsigned pointer, int words) {
+	if (level == levels.size()) {
+		mem_words_read += words;
+		return false;
+	}
 
-		// Now we have to fetch data from RAM and write to cache
-		bool written = false;
-		if (regDst != 0)
-			registers[regDst] = memory[pointer];
+	CacheLevel &cache = levels[level];
+	if (cache.mode != MODE_EXCLUSIVE) {
+		if (cache.find(pointer) == -1)
+			allocate_block(level, pointer);
+		return false;
+	}
 
-		// Write to L2 cache
-		if (blocks2 != 0) {
-			int L2row = (pointer / blocks2) % (L2cache.size() / assoc2);
-			int L2tag = (pointer / blocks2) / (L2cache.size() / assoc2);
+	int index = cache.find(pointer);
+	if (index == -1)
+		return fetch_block(level + 1, pointer, words);
 
-			// Fetch all data from that block in RAM
-			vector<int> blockdata_for_L2;
-			for (size_t i = 0; i < blocks2; i++) {
-				blockdata_for_L2.push_back(memory[(pointer / blocks2) * blocks2 + i]);
-			}
+	bool dirty = cache.lines[index].dirty;
+	cache.invalidate(index);
+	return dirty;
+}
 
-			// Check for free blocks in L2 cache
-			for (size_t i = 0; i < assoc2; i++) {	
-				if (L2cache[L2row * assoc2 + i][1] == 0) {
-					// Write to L2 cache
-					L2cache[L2row * assoc2 + i][1] = 1;
-					L2cache[L2row * assoc2 + i][2] = L2tag;
-					L2blockdata[L2row * assoc2 + i] = blockdata_for_L2;
+// Takes a level and a memory address
+// Fetches the block holding the address from the next level and places it in the cache.
+// L1 takes the block out of the victim cache if it is there, and with multiple cores
+// it snoops the other L1s to find out whether it gets the block exclusively.
+// Returns the index of the filled line
+int allocate_block(size_t level, unsigned pointer) {
+	bool dirty = false;
+	bool shared = (level == 0 && cores.size() > 1) ? snoop_read(pointer) : false;
+	int entry = (level == 0) ? find_victim(pointer) : -1;
+
+	if (entry != -1) {
+		dirty = victim_cache[entry].dirty;
+		victim_cache[entry].valid = false;
+	} else
+		dirty = fetch_block(level + 1, pointer, levels[level].blocksize);
+
+	int index = place_block(level, pointer);
+	levels[level].lines[index].dirty = dirty;
+	if (level == 0) {
+		levels[0].lines[index].exclusive = dirty || (!shared && coherence == COHERENCE_MESI);
+		if (cores.size() > 1)
+			cores[current_core].invalidated.erase(levels[0].block_address(index));
+	}
+	return index;
+}
 
-					written = true;
-					updateMRU(2, L2row, L2row * assoc2 + i, assoc2);
-					break;
-				}
-			}
+// Takes a level and the index of a line that a demand access just hit
+// Returns true if the block was brought in by the prefetcher
+// and had not been used yet, counting the prefetch as useful
+bool use_prefetched_block(size_t level, int index) {
+	CacheLine &line = levels[level].lines[index];
+	if (!line.prefetched)
+		return false;
 
-			// If no free blocks in L2 cache
-			if (!written) {
-				int LRU_data = L2MRU[L2row].front();
+	line.prefetched = false;
+	levels[level].useful_prefetches++;
+	return true;
+}
 
-				// Write to L2 cache
-				L2cache[LRU_data][2] = L2tag;
-				L2blockdata[LRU_data] = blockdata_for_L2;
+// Takes a level, a memory address loaded by the instruction at pc, and whether
+// the access missed or hit a prefetched block.
+// Trains the level's prefetcher and queues the blocks it wants to fetch
+void train_prefetcher(size_t level, unsigned pointer, bool trigger) {
+	CacheLevel &cache = levels[level];
+	int block = cache.block_of(pointer);
+
+	if (cache.prefetcher == PF_NEXTLINE) {
+		// Tagged next-line: fetch ahead on misses and on first use of a prefetched block
+		if (trigger) {
+			for (int i = 1; i <= prefetch_degree; i++)
+				pending_prefetches.push_back({level, (block + i) * cache.blocksize});
+		}
+	}
 
-				updateMRU(2, L2row, LRU_data, assoc2);
-			}
+	else if (cache.prefetcher == PF_STRIDE) {
+		StrideEntry &entry = cache.stride_table[pc % STRIDE_TABLE_SIZE];
+		if (entry.pc != pc) {
+			entry.pc = pc;
+			entry.last_addr = pointer;
+			entry.stride = 0;
+			entry.confidence = 0;
+			return;
 		}
 
-		// Reset written boolean
-		written = false;
+		int stride = pointer - entry.last_addr;
+		if (stride == entry.stride) {
+			if (entry.confidence < 3)
+				entry.confidence++;
+		} else if (entry.confidence > 0)
+			entry.confidence--;
+		else
+			entry.stride = stride;
+		entry.last_addr = pointer;
 
-		// Fetching data from block in RAM
-		vector<int> blockdata_for_L1;
-		for (size_t i = 0; i < blocks1; i++) {
-			blockdata_for_L1.push_back(memory[(pointer / blocks1) * blocks1 + i]);
+		if (entry.confidence >= 2 && entry.stride != 0) {
+			for (int i = 1; i <= prefetch_degree; i++)
+				pending_prefetches.push_back({level, pointer + entry.stride * i});
 		}
+	}
 
-		// Check for free blocks in L1 cache
-		for (size_t i = 0; i < assoc1; i++) {	
-			if (L1cache[L1row * assoc1 + i][1] == 0) {
-				// Write to L1 cache
-				L1cache[L1row * assoc1 + i][1] = 1;
-				L1cache[L1row * assoc1 + i][2] = L1tag;
-				L1blockdata[L1row * assoc1 + i] = blockdata_for_L1;
+	else if (cache.prefetcher == PF_STREAM) {
+		if (!trigger)
+			return;
+		prefetch_clock++;
+
+		// Continue a stream if the block is at most two blocks past its last block
+		for (StreamEntry &entry : cache.stream_table) {
+			int distance = block - entry.last_block;
+			if (!entry.valid || distance == 0 || distance > 2 || distance < -2)
+				continue;
+
+			int direction = (distance > 0) ? 1 : -1;
+			if (direction == entry.direction)
+				entry.confidence++;
+			else {
+				entry.direction = direction;
+				entry.confidence = 1;
+			}
+			entry.last_block = block;
+			entry.last_used = prefetch_clock;
 
-				written = true;
-				updateMRU(1, L1row, L1row * assoc1 + i, assoc1);
-				break;
+			if (entry.confidence >= 2) {
+				for (int i = 1; i <= prefetch_degree; i++)
+					pending_prefetches.push_back({level, (block + entry.direction * i) * cache.blocksize});
 			}
+			return;
 		}
 
-		// If no free blocks in L1 cache
-		if (!written) {
-			int LRU_data = L1MRU[L1row].front();
-
-			// Write to L1 cache
-			L1cache[LRU_data][2] = L1tag;
-			L1blockdata[LRU_data] = blockdata_for_L1;
-
-			updateMRU(1, L1row, LRU_data, assoc1);
+		// Otherwise start a new stream in the LRU entry
+		StreamEntry *victim = &cache.stream_table[0];
+		for (StreamEntry &entry : cache.stream_table) {
+			if (!entry.valid || entry.last_used < victim->last_used)
+				victim = &entry;
+			if (!entry.valid)
+				break;
 		}
-		
-		increment_pc();
-		return false;
+		victim->valid = true;
+		victim->last_block = block;
+		victim->direction = 0;
+		victim->confidence = 0;
+		victim->last_used = prefetch_clock;
 	}
+}
 
-	else if (op_code == op_sw) {
-		regSrcA = (instruction >> 10) & 7;
-		regDst = (instruction >> 7) & 7;
-		imm = instruction & 127;
-
-		if (imm > 63)
-			imm = to_signed_binary(imm);
-
-		unsigned pointer = (registers[regSrcA] + imm) & 8191;
-
-		memory[pointer] = registers[regDst];
-
-		/*Start of cache simulation*/
-		int L1row = (pointer / blocks1) % (L1cache.size() / assoc1);
-		int L1tag = (pointer / blocks1) / (L1cache.size() / assoc1);
-
-		bool written = false;
+bool classify_misses = false;	// set by --classify
+
+// Takes a level, a memory address it was asked for, and whether the level missed
+// References the block in the level's shadow cache and counts the class of a miss
+// Returns the name of the class for the log, or "" for a hit or without --classify
+const char *classify_access(CacheLevel &cache, unsigned pointer, bool miss) {
+	if (!classify_misses)
+		return "";
+	int kind = cache.shadow.access(pointer);
+	if (!miss)
+		return "";
+
+	MissCounts &total = cache.miss_classes;
+	MissCounts &at_pc = cache.pc_miss_classes[pc];
+	if (kind == MISS_COMPULSORY) {
+		total.compulsory++;
+		at_pc.compulsory++;
+		return "compulsory";
+	}
+	if (kind == MISS_CAPACITY) {
+		total.capacity++;
+		at_pc.capacity++;
+		return "capacity";
+	}
+	total.conflict++;
+	at_pc.conflict++;
+	return "conflict";
+}
 
-		// Fetch data from block in RAM
-		vector<int> blockdata_for_L1;
-		for (size_t i = 0; i < blocks1; i++) {
-			blockdata_for_L1.push_back(memory[(pointer / blocks1) * blocks1 + i]);
+// Takes a memory address loaded by the instruction at pc
+// Checks each level in turn, and the victim cache after L1, logging a "HIT" or "MISS"
+// for every cache checked, and fills the block into every level that missed.
+// The prefetcher of every level checked is trained on the access.
+// Returns the loaded value
+unsigned cache_read(unsigned pointer) {
+	unsigned value = model_memory[pointer];
+	last_read_level = 0;
+	last_read_victim = false;
+
+	for (size_t level = 0; level < levels.size(); level++) {
+		CacheLevel &cache = levels[level];
+		int index = cache.find(pointer);
+		if (index != -1) {
+			cache.read_hits++;
+			last_read_level = level + 1;
+			classify_access(cache, pointer, false);
+			print_log_entry(cache, false, LOG_HIT, pc, pointer, cache.row_of(pointer));
+			cache.touch(index);
+			train_prefetcher(level, pointer, use_prefetched_block(level, index));
+			if (!tag_only)
+				value = cache.blockdata[index][cache.offset_of(pointer)];	// Fetch data from cache
+			break;
 		}
 
-		// Check for free blocks in L1 cache
-		for (size_t i = 0; i < assoc1; i++) {	
-			if (L1cache[L1row * assoc1 + i][1] == 0) {
-				// Write to L1 cache
-				L1cache[L1row * assoc1 + i][1] = 1;
-				L1cache[L1row * assoc1 + i][2] = L1tag;
-				L1blockdata[L1row * assoc1 + i] = blockdata_for_L1;
-
-				written = true;
-				print_log_entry("L1", "SW", pc, pointer, L1row);
-				updateMRU(1, L1row, L1row * assoc1 + i, assoc1);
+		cache.read_misses++;
+		print_log_entry(cache, false, LOG_MISS, pc, pointer, cache.row_of(pointer), classify_access(cache, pointer, true));
+		train_prefetcher(level, pointer, true);
+		if (level == 0)
+			note_L1_miss(pointer);
+
+		// Check the victim cache before going to L2, swapping a hit back into L1
+		if (level == 0 && victim_cache.size() > 0) {
+			int entry = find_victim(pointer);
+			if (entry != -1) {
+				victim_hits++;
+				last_read_level = 1;
+				last_read_victim = true;
+				print_log_entry(cache, true, LOG_HIT, pc, pointer, entry);
 				break;
 			}
+			victim_misses++;
+			print_log_entry(cache, true, LOG_MISS, pc, pointer, 0);
 		}
 
-		// If no free blocks in L1 cache
-		if (!written) {
-			int LRU_data = L1MRU[L1row].front();
+		// Other cores flush a modified copy before the shared levels are read
+		if (level == 0 && cores.size() > 1)
+			snoop_read(pointer);
+	}
 
-			// Write to L1 cache
-			L1cache[LRU_data][2] = L1tag;
-			L1blockdata[LRU_data] = blockdata_for_L1;
+	// Fill L1, which pulls the block through every level that missed
+	if (last_read_level != 1 || last_read_victim)
+		allocate_block(0, pointer);
+	return value;
+}
 
-			print_log_entry("L1", "SW", pc, pointer, L1row);
-			updateMRU(1, L1row, LRU_data, assoc1);
+// Takes a level and a memory address that was just stored to memory[]
+// Applies the level's write policy, logging a "SW" entry if the cache ends up
+// holding the written block.
+// Returns true if the write has to be passed on to the next level
+bool write_to_cache(size_t level, unsigned pointer) {
+	CacheLevel &cache = levels[level];
+	int index = cache.find(pointer);
+	classify_access(cache, pointer, false);	// only read misses are logged as MISS
+
+	if (index != -1) {
+		cache.write_hits++;
+		cache.touch(index);
+		use_prefetched_block(level, index);
+	} else {
+		cache.write_misses++;
+		if (level == 0)
+			note_L1_miss(pointer);
+
+		// A block waiting in the victim cache takes the write in place of L1
+		int entry = (level == 0 && victim_cache.size() > 0) ? find_victim(pointer) : -1;
+		if (!cache.write_allocate && entry != -1 && cache.write_back) {
+			victim_cache[entry].dirty = true;
+			return false;
 		}
 
-		// Write to L2 cache if it exists
-		if (blocks2 != 0) {
-			int L2row = (pointer / blocks2) % (L2cache.size() / assoc2);
-			int L2tag = (pointer / blocks2) / (L2cache.size() / assoc2);
+		// An exclusive level never allocates blocks that the level above holds
+		if (!cache.write_allocate || (cache.mode == MODE_EXCLUSIVE && held_above(level, pointer)))
+			return true;
+		index = allocate_block(level, pointer);
+	}
 
-			written = false;
+	if (!tag_only)
+		cache.blockdata[index][cache.offset_of(pointer)] = model_memory[pointer];
+	print_log_entry(cache, false, LOG_SW, pc, pointer, cache.row_of(pointer));
+	if (level == 0)
+		cache.lines[index].exclusive = true;	// snoop_write removed every other copy
 
-			vector<int> blockdata_for_L2;
-			for (size_t i = 0; i < blocks2; i++) {
-				blockdata_for_L2.push_back(memory[(pointer / blocks2) * blocks2 + i]);
-			}
+	if (cache.write_back) {
+		cache.lines[index].dirty = true;
+		return false;
+	}
+	return true;
+}
+
+// Takes a memory address that was just stored to memory[] by the instruction at pc
+// Sends the write down the levels and on to memory for as far as the write policies require.
+// memory[] itself is always kept up to date; the dirty bits only track the traffic
+// a write-back cache would cause. With multiple cores the other copies are invalidated first.
+void cache_write(unsigned pointer) {
+	if (cores.size() > 1)
+		snoop_write(pointer);
+	for (size_t level = 0; level < levels.size(); level++) {
+		if (!write_to_cache(level, pointer))
+			return;
+	}
+	mem_words_written++;
+}
+
+// Takes the current cycle
+// Waits for the MSHR that frees up first, counting the wait as an MSHR stall.
+// Returns the index of that MSHR
+int acquire_mshr(long &now) {
+	int slot = 0;
+	for (size_t i = 1; i < timing.mshr_free_at.size(); i++) {
+		if (timing.mshr_free_at[i] < timing.mshr_free_at[slot])
+			slot = i;
+	}
+
+	if (timing.mshr_free_at[slot] > now) {
+		timing.mshr_stalls += timing.mshr_free_at[slot] - now;
+		now = timing.mshr_free_at[slot];
+	}
+	return slot;
+}
+
+// Takes the cycle a DRAM transfer is requested and the number of words moved
+// Returns the cycle the transfer starts, once the DRAM channel is free,
+// and reserves the channel for the duration of the transfer
+long schedule_dram(long now, long words) {
+	long start = max(now, timing.dram_free_at);
+	timing.dram_free_at = start + words * timing.dram_cycles_per_word;
+	return start;
+}
+
+// Takes the current cycle and the number of words written to DRAM by an access
+// Posts the writes into an MSHR so they complete in the background
+void post_dram_writes(long &now, long words) {
+	if (words == 0)
+		return;
+
+	int slot = acquire_mshr(now);
+	long start = schedule_dram(now, words);
+	timing.mshr_free_at[slot] = start + timing.latency.back() + words * timing.dram_cycles_per_word;
+}
+
+// Takes the number of words read from and written to DRAM by the last load
+// Adds the stall cycles of the load to the cycle count
+void timing_load(long words_read, long words_written) {
+	long start = timing.cycles;
+	long now = start;
+	int num_caches = timing.latency.size() - 1;
+
+	// The base cycle of the instruction covers one cycle of the L1 hit latency.
+	// A victim cache hit costs one more cycle for the swap.
+	int L1cycles = timing.latency[0] - 1 + (last_read_victim ? 1 : 0);
+	now += L1cycles;
+	timing.level_stalls[0] += L1cycles;
+
+	if (last_read_level != 1) {
+		int slot = acquire_mshr(now);
+		int last_level = (last_read_level == 0) ? num_caches : last_read_level;
+
+		for (int level = 2; level <= last_level; level++) {
+			now += timing.latency[level - 1];
+			timing.level_stalls[level - 1] += timing.latency[level - 1];
+		}
+
+		if (last_read_level == 0) {
+			long dram_start = schedule_dram(now, words_read);
+			timing.queue_stalls += dram_start - now;
+			long dram_cycles = timing.latency.back() + words_read * timing.dram_cycles_per_word;
+			now = dram_start + dram_cycles;
+			timing.level_stalls.back() += dram_cycles;
+		}
+		timing.mshr_free_at[slot] = now;
+	}
+
+	post_dram_writes(now, words_written);
+
+	timing.mem_accesses++;
+	timing.mem_access_cycles += now - start + 1;
+	timing.cycles = now;
+}
 
-			// Check for free blocks in L2 cache
-			for (size_t i = 0; i < assoc2; i++) {	
-				if (L2cache[L2row * assoc2 + i][1] == 0) {
-					// Write to L2 cache
-					L2cache[L2row * assoc2 + i][1] = 1;
-					L2cache[L2row * assoc2 + i][2] = L2tag;
-					L2blockdata[L2row * assoc2 + i] = blockdata_for_L2;
+// Takes the number of words read from and written to DRAM by the last store
+// Stores retire into the write buffer, so only waiting for an MSHR stalls
+void timing_store(long words_read, long words_written) {
+	long start = timing.cycles;
+	long now = start;
 
-					written = true;
-					print_log_entry("L2", "SW", pc, pointer, L2row);
-					updateMRU(2, L2row, L2row * assoc2 + i, assoc2);
+	post_dram_writes(now, words_read + words_written);
+
+	timing.mem_accesses++;
+	timing.mem_access_cycles += now - start + 1;
+	timing.cycles = now;
+}
+
+// Fills the blocks queued by the prefetchers during the last load into their
+// caches and logs a "PF" entry for each. Requests for blocks that are already
+// cached or outside memory are ignored. With the cycle model enabled, each
+// prefetch holds an MSHR until its fill completes and is dropped if none is free.
+void issue_prefetches() {
+	for (size_t i = 0; i < pending_prefetches.size(); i++) {
+		size_t level = pending_prefetches[i].first;
+		unsigned addr = pending_prefetches[i].second;
+		CacheLevel &cache = levels[level];
+		if (addr >= MEM_SIZE || cache.find(addr) != -1)
+			continue;
+		if (cache.mode == MODE_EXCLUSIVE && held_above(level, addr))
+			continue;
+
+		int slot = -1;
+		if (timing.enabled) {
+			for (size_t j = 0; j < timing.mshr_free_at.size(); j++) {
+				if (timing.mshr_free_at[j] <= timing.cycles) {
+					slot = j;
 					break;
 				}
 			}
+			if (slot == -1) {
+				cache.dropped_prefetches++;
+				continue;
+			}
+		}
+
+		long words = mem_words_read + mem_words_written;
+		int index = allocate_block(level, addr);
+		cache.lines[index].prefetched = true;
+		cache.prefetches++;
+		print_log_entry(cache, false, LOG_PF, pc, addr, cache.row_of(addr));
+
+		if (timing.enabled) {
+			words = mem_words_read + mem_words_written - words;
+			if (words == 0)
+				timing.mshr_free_at[slot] = timing.cycles + timing.latency[level + 1];
+			else {
+				long start = schedule_dram(timing.cycles, words);
+				timing.mshr_free_at[slot] = start + timing.latency.back() + words * timing.dram_cycles_per_word;
+			}
+		}
+	}
+	pending_prefetches.clear();
+}
+
+// Takes a cache level and prints the classes of its read misses, in total and
+// for each pc that missed
+void print_miss_classes(const CacheLevel &cache) {
+	const MissCounts &total = cache.miss_classes;
+	cout << "Misses " << cache.name << " compulsory " << total.compulsory <<
+		", capacity " << total.capacity << ", conflict " << total.conflict << endl;
+	for (auto &entry : cache.pc_miss_classes) {
+		const MissCounts &at_pc = entry.second;
+		cout << "  pc:" << setw(5) << entry.first << " compulsory " << at_pc.compulsory <<
+			", capacity " << at_pc.capacity << ", conflict " << at_pc.conflict << endl;
+	}
+}
+
+// Takes a cache level and prints the accuracy and coverage of its prefetcher.
+// Coverage is the share of would-be misses that prefetching removed.
+void print_prefetch_stats(const CacheLevel &cache) {
+	const string names[] = {"none", "nextline", "stride", "stream"};
+	long misses = cache.read_misses + cache.write_misses;
+
+	cout << fixed << setprecision(2);
+	cout << "Prefetch " << cache.name << " " << names[cache.prefetcher] <<
+		": issued " << cache.prefetches << ", useful " << cache.useful_prefetches <<
+		", useless " << cache.useless_prefetches << ", dropped " << cache.dropped_prefetches <<
+		", accuracy " << (cache.prefetches ? 100.0 * cache.useful_prefetches / cache.prefetches : 0.0) << "%" <<
+		", coverage " << (cache.useful_prefetches + misses ? 100.0 * cache.useful_prefetches / (cache.useful_prefetches + misses) : 0.0) << "%" <<
+		", misses avoided " << cache.useful_prefetches << endl;
+}
+
+// Prints the cycle count, average memory access time and stall breakdown
+void print_timing_stats() {
+	cout << fixed << setprecision(2);
+	cout << "Timing: cycles " << timing.cycles << ", instructions " << timing.instructions <<
+		", CPI " << (double)timing.cycles / timing.instructions << endl;
+	cout << "Memory accesses " << timing.mem_accesses << ", average memory access time " <<
+		(timing.mem_accesses ? (double)timing.mem_access_cycles / timing.mem_accesses : 0.0) <<
+		" cycles" << endl;
+
+	cout << "Stall cycles:";
+	for (size_t level = 0; level + 1 < timing.level_stalls.size(); level++)
+		cout << " " << levels[level].name << " " << timing.level_stalls[level] << ",";
+	cout << " DRAM " << timing.level_stalls.back() << ", DRAM queue " << timing.queue_stalls <<
+		", MSHR " << timing.mshr_stalls << endl;
+}
+
+// Returns every cache: the L1 of each core, then the shared levels
+vector<CacheLevel *> cache_list() {
+	vector<CacheLevel *> caches;
+	for (size_t id = 0; id < cores.size(); id++)
+		caches.push_back(&core_L1(id));
+	for (size_t level = cores.empty() ? 0 : 1; level < levels.size(); level++)
+		caches.push_back(&levels[level]);
+	return caches;
+}
+
+// Prints the instruction count and coherence traffic of each core
+void print_core_stats() {
+	for (size_t id = 0; id < cores.size(); id++) {
+		Core &core = cores[id];
+		cout << "Core " << id << " instructions " << core.instructions <<
+			", coherence misses " << core.coherence_misses <<
+			", invalidations " << core.invalidations << ", upgrades " << core.upgrades <<
+			", flushes " << core.flushes << endl;
+	}
+}
+
+// Takes a cache level and prints its hit, miss and writeback counts
+void print_cache_stats(const CacheLevel &cache) {
+	cout << "Cache " << cache.name << " reads " << cache.read_hits + cache.read_misses <<
+		" (hits " << cache.read_hits << ", misses " << cache.read_misses << ")" <<
+		", writes " << cache.write_hits + cache.write_misses <<
+		" (hits " << cache.write_hits << ", misses " << cache.write_misses << ")" <<
+		", writebacks " << cache.writebacks << endl;
+}
+
+// Fenwick tree over access times. Each block referenced so far is marked at the time
+// of its latest access, so the marks after a time count the distinct blocks since.
+struct FenwickTree {
+	vector<int> tree;
+
+	// Takes a number of times, numbered from 1
+	void reset(size_t size) {
+		tree.assign(size + 1, 0);
+	}
+
+	void add(int time, int delta) {
+		for (; time < (int)tree.size(); time += time & -time)
+			tree[time] += delta;
+	}
+
+	// Returns the number of marks at times 1 to time
+	int prefix(int time) const {
+		int sum = 0;
+		for (; time > 0; time -= time & -time)
+			sum += tree[time];
+		return sum;
+	}
+};
+
+// Stride seen by one load or store instruction
+struct StrideProfile {
+	unsigned last_addr = 0;
+	int stride = 0;			// difference between its last two addresses
+	long accesses = 0;
+	long matches = 0;		// accesses that repeated the previous stride
+};
+
+// Number of buckets in the reuse distance histogram: 0, 1, 2-3, 4-7, ... 4096-8191,
+// which covers every distance between the blocks of memory
+size_t const static REUSE_BUCKETS = 14;
+
+// Cache-independent profile of the loads and stores of a program, set up by --reuse-profile:
+// block reuse distances, working-set size over a sliding window, and per-pc strides.
+// Times are renumbered when the Fenwick tree fills up, so its size stays bounded
+// by the number of blocks however long the trace is.
+struct ReuseProfile {
+	bool enabled = false;
+	string filename;
+	int blocksize = 1;
+	int window = 1024;			// accesses in a working-set window
+
+	long accesses = 0;
+	int now = 0;				// time of the latest access in the Fenwick tree
+	FenwickTree marks;
+	vector<int> last_time;		// time of each block's latest access, 0 if never accessed
+	long reuse[REUSE_BUCKETS] = {};
+	long cold = 0;				// first accesses to a block
+
+	vector<int> recent;			// blocks of the last window accesses, as a ring
+	vector<int> in_window;		// accesses to each block within the window
+	int window_blocks = 0;		// distinct blocks within the window
+	vector<int> working_set;	// window_blocks at the end of every window accesses
+
+	map<unsigned, StrideProfile> strides;	// by pc
+
+	void start() {
+		int blocks = MEM_SIZE / blocksize + 1;
+		marks.reset(2 * blocks);
+		last_time.assign(blocks, 0);
+		recent.assign(window, -1);
+		in_window.assign(blocks, 0);
+		enabled = true;
+	}
+
+	// Renumbers the latest access times of the blocks 1, 2, ... in order
+	void compact() {
+		vector<pair<int, int>> live;	// time, block
+		for (size_t block = 0; block < last_time.size(); block++) {
+			if (last_time[block] > 0)
+				live.push_back({last_time[block], block});
+		}
+		sort(live.begin(), live.end());
+		marks.reset(marks.tree.size() - 1);
+		now = 0;
+		for (auto &entry : live) {
+			last_time[entry.second] = ++now;
+			marks.add(now, 1);
+		}
+	}
+
+	// Takes the pc of a load or store and the address it accesses
+	void access(unsigned pc, unsigned pointer) {
+		int block = pointer / blocksize;
+
+		// Reuse distance: distinct blocks accessed since this block's latest access
+		if (now + 1 >= (int)marks.tree.size())
+			compact();
+		now++;
+		if (last_time[block] == 0)
+			cold++;
+		else {
+			int distance = marks.prefix(now - 1) - marks.prefix(last_time[block]);
+			int bucket = 0;
+			while (distance > 0) {
+				bucket++;
+				distance >>= 1;
+			}
+			reuse[bucket]++;
+			marks.add(last_time[block], -1);
+		}
+		last_time[block] = now;
+		marks.add(now, 1);
+
+		// Working set: distinct blocks among the last window accesses
+		int &oldest = recent[accesses % window];
+		if (oldest != -1 && --in_window[oldest] == 0)
+			window_blocks--;
+		oldest = block;
+		if (in_window[block]++ == 0)
+			window_blocks++;
+		accesses++;
+		if (accesses % window == 0)
+			working_set.push_back(window_blocks);
+
+		StrideProfile &entry = strides[pc];
+		if (entry.accesses > 0) {
+			int stride = (int)pointer - (int)entry.last_addr;
+			if (entry.accesses > 1 && stride == entry.stride)
+				entry.matches++;
+			entry.stride = stride;
+		}
+		entry.last_addr = pointer;
+		entry.accesses++;
+	}
+
+	// Takes a bucket of the reuse histogram
+	// Returns the smallest and largest distances it counts
+	pair<long, long> bucket_range(size_t bucket) const {
+		if (bucket == 0)
+			return {0, 0};
+		return {1L << (bucket - 1), (1L << bucket) - 1};
+	}
+
+	void write_csv(ostream &out) const {
+		out << "section,key,value,accesses,matches" << endl;
+		for (size_t bucket = 0; bucket < REUSE_BUCKETS; bucket++) {
+			pair<long, long> range = bucket_range(bucket);
+			out << "reuse," << range.first << "-" << range.second << "," << reuse[bucket] << ",," << endl;
+		}
+		out << "reuse,cold," << cold << ",," << endl;
+		for (size_t i = 0; i < working_set.size(); i++)
+			out << "working_set," << (i + 1) * window << "," << working_set[i] << ",," << endl;
+		for (auto &entry : strides) {
+			const StrideProfile &stride = entry.second;
+			out << "stride," << entry.first << "," << stride.stride << "," << stride.accesses <<
+				"," << stride.matches << endl;
+		}
+	}
+
+	void write_json(ostream &out) const {
+		out << "{" << endl;
+		out << "  \"block_size\": " << blocksize << "," << endl;
+		out << "  \"accesses\": " << accesses << "," << endl;
+		out << "  \"reuse\": {" << endl;
+		out << "    \"cold\": " << cold << "," << endl;
+		out << "    \"buckets\": [";
+		for (size_t bucket = 0; bucket < REUSE_BUCKETS; bucket++) {
+			pair<long, long> range = bucket_range(bucket);
+			out << (bucket ? ", " : "") << "{\"min\": " << range.first << ", \"max\": " << range.second <<
+				", \"count\": " << reuse[bucket] << "}";
+		}
+		out << "]" << endl << "  }," << endl;
+		out << "  \"working_set\": {" << endl;
+		out << "    \"window\": " << window << "," << endl;
+		out << "    \"samples\": [";
+		for (size_t i = 0; i < working_set.size(); i++)
+			out << (i ? ", " : "") << working_set[i];
+		out << "]" << endl << "  }," << endl;
+		out << "  \"strides\": [";
+		bool first = true;
+		for (auto &entry : strides) {
+			const StrideProfile &stride = entry.second;
+			out << (first ? "" : ",") << endl << "    {\"pc\": " << entry.first << ", \"stride\": " << stride.stride <<
+				", \"accesses\": " << stride.accesses << ", \"matches\": " << stride.matches << "}";
+			first = false;
+		}
+		out << endl << "  ]" << endl << "}" << endl;
+	}
+};
+
+ReuseProfile reuse_profile;
+
+// Per-pc execution counts, written by --profile as a listing annotated with the
+// source comments of the machine code, and as collapsed call stacks for flame
+// graphs. Calls are tracked by jal and returns by jr.
+struct ExecutionProfile {
+	bool enabled = false;
+	string filename;
+	long executed[MEM_SIZE] = {};
+	long taken[MEM_SIZE] = {};		// jeq that branched
+	long not_taken[MEM_SIZE] = {};
+	long misses[MEM_SIZE] = {};		// L1 misses of lw and sw
+	vector<string> source;			// comment of each loaded word
+
+	// Call stacks as a tree: each frame has a parent and a function, the pc it was
+	// called at. The first frames are the roots, one per core. Instructions are
+	// added to a frame when its core leaves it, so running one costs nothing here.
+	vector<int> parent;
+	vector<unsigned> function;
+	vector<long> frame_count;		// instructions run in each frame
+	map<pair<int, unsigned>, int> children;
+	vector<int> frame;				// current frame of each core
+	vector<long> entered;			// instructions the core had run when it entered its frame
+
+	void start(size_t num_cores) {
+		for (size_t id = 0; id < num_cores; id++) {
+			parent.push_back(-1);
+			function.push_back(0);
+			frame_count.push_back(0);
+			frame.push_back(id);
+		}
+		entered.assign(num_cores, 0);
+		enabled = true;
+	}
+
+	// Takes a core, the instructions it has run, and the frame it moves to
+	void enter(size_t core, long ran, int next) {
+		frame_count[frame[core]] += ran - entered[core];
+		entered[core] = ran;
+		frame[core] = next;
+	}
+
+	// Takes a core that ran jal, the instructions it has run including the jal, and
+	// the pc it called
+	void call(size_t core, long ran, unsigned target) {
+		auto found = children.find({frame[core], target});
+		if (found == children.end()) {
+			found = children.insert({{frame[core], target}, (int)parent.size()}).first;
+			parent.push_back(frame[core]);
+			function.push_back(target);
+			frame_count.push_back(0);
+		}
+		enter(core, ran, found->second);
+	}
+
+	// Takes a core that ran jr and the instructions it has run including the jr
+	void ret(size_t core, long ran) {
+		if (parent[frame[core]] >= 0)
+			enter(core, ran, parent[frame[core]]);
+	}
+
+	// Takes the instructions each core has run
+	// Adds the instructions of the frames the cores are still in
+	void finish(const vector<long> &ran) {
+		for (size_t core = 0; core < frame.size(); core++)
+			enter(core, ran[core], frame[core]);
+	}
+
+	// Takes a pc and returns the name of the function there: its first label, or pc_N
+	string function_name(unsigned at) const {
+		if (at < source.size()) {
+			size_t colon = source[at].find(':');
+			if (colon != string::npos)
+				return source[at].substr(0, colon);
+		}
+		return "pc_" + to_string(at);
+	}
+
+	// Writes every loaded word, and every pc run beyond them, with its counts and source
+	void write_listing(ostream &out) const {
+		long total = 0;
+		for (size_t at = 0; at < MEM_SIZE; at++)
+			total += executed[at];
+		out << "   pc    executed    time    taken  not taken   misses  source" << endl;
+		for (size_t at = 0; at < MEM_SIZE; at++) {
+			if (at >= source.size() && executed[at] == 0)
+				continue;
+			out << setw(5) << at << setw(12) << executed[at] << setw(7) << fixed << setprecision(2) <<
+				(total ? 100.0 * executed[at] / total : 0.0) << "%";
+			if (executed[at] > 0 && (memory[at] >> 13) == op_jeq)
+				out << setw(9) << taken[at] << setw(11) << not_taken[at];
+			else
+				out << setw(9) << "" << setw(11) << "";
+			if (executed[at] > 0 && ((memory[at] >> 13) == op_lw || (memory[at] >> 13) == op_sw))
+				out << setw(9) << misses[at];
+			else
+				out << setw(9) << "";
+			out << "  " << ((at < source.size()) ? source[at] : "") << endl;
+		}
+	}
+
+	// Writes one line per call stack, its frames separated by ; and then its count
+	void write_stacks(ostream &out) const {
+		for (size_t id = 0; id < parent.size(); id++) {
+			if (frame_count[id] == 0)
+				continue;
+			string stack = "";
+			for (int at = id; at >= 0; at = parent[at]) {
+				string name = function_name(function[at]);
+				if (parent[at] < 0)
+					name = (frame.size() > 1) ? "core" + to_string(at) : "main";
+				stack = (stack == "") ? name : name + ";" + stack;
+			}
+			out << stack << " " << frame_count[id] << endl;
+		}
+	}
+};
+
+ExecutionProfile execution_profile;
+
+// Direction predictors for jeq, chosen with --predictor
+enum Predictor { BP_STATIC, BP_BIMODAL, BP_GSHARE };
+
+// Branch predictor, enabled with --predictor, --btb or --ras. Each core has its
+// own tables, of fixed sizes, consulted after an instruction runs with the pc it
+// went to. A jeq is mispredicted if its direction is, a taken transfer if the
+// predicted target is wrong: without a BTB, the targets of jeq, j and jal are
+// known once they are decoded, and jr is always mispredicted. jal pushes its
+// return address on the return-address stack and jr pops it.
+struct BranchPredictor {
+	bool enabled = false;
+	int kind = BP_BIMODAL;
+	size_t entries = 1024;		// 2-bit counters, a power of two
+	size_t btb_entries = 0;		// direct-mapped, a power of two, or 0 for no BTB
+	size_t ras_entries = 0;
+
+	// Tables of one core
+	struct Tables {
+		vector<uint8_t> counters;
+		unsigned history = 0;		// jeq outcomes, latest in bit 0, for gshare
+		vector<int> btb_pc;			// pc of the jump in each BTB entry, or -1
+		vector<unsigned> btb_target;
+		vector<unsigned> ras;		// circular: a deep call chain overwrites the oldest
+		size_t ras_top = 0;
+		size_t ras_depth = 0;
+	};
+	vector<Tables> tables;
+
+	long branches = 0;				// jeq
+	long branch_mispredicts = 0;
+	long jumps = 0;					// j and jal
+	long jump_mispredicts = 0;
+	long returns = 0;				// jr
+	long return_mispredicts = 0;
+	long executed[MEM_SIZE] = {};
+	long mispredicted[MEM_SIZE] = {};
+
+	void start(size_t num_cores) {
+		Tables empty;
+		empty.counters.assign(entries, 1);	// weakly not taken
+		empty.btb_pc.assign(btb_entries, -1);
+		empty.btb_target.assign(btb_entries, 0);
+		empty.ras.assign(ras_entries, 0);
+		tables.assign(num_cores, empty);
+		enabled = true;
+	}
+
+	// Takes a core's tables, the pc of a taken transfer and where it went
+	// Returns true if the BTB predicted the target, and updates it
+	bool btb_hit(Tables &t, unsigned at, unsigned next) {
+		size_t index = at & (btb_entries - 1);
+		bool hit = t.btb_pc[index] == (int)at && t.btb_target[index] == next;
+		t.btb_pc[index] = at;
+		t.btb_target[index] = next;
+		return hit;
+	}
+
+	// Takes the core, the pc and instruction that ran, and the pc after it
+	// Predicts the instruction if it transfers control, and counts the outcome
+	// Returns true if it was mispredicted
+	bool resolve(size_t core, unsigned at, unsigned instruction, unsigned next) {
+		unsigned op_code = instruction >> 13;
+		bool is_jr = op_code == op_jr && (instruction & 15) == 8;
+		if (op_code != op_jeq && op_code != op_j && op_code != op_jal && !is_jr)
+			return false;
+		if (op_code == op_j && next == at)
+			return false;	// halt
+		Tables &t = tables[core];
+		bool wrong;
+
+		if (op_code == op_jeq) {
+			bool taken = next != (at + 1) % MEM_SIZE;
+			size_t index = (kind == BP_GSHARE ? at ^ t.history : at) & (entries - 1);
+			bool predicted = (kind == BP_STATIC) ? (instruction & 64) != 0 : t.counters[index] >= 2;
+			bool target_known = !taken || btb_entries == 0 || btb_hit(t, at, next);
+			wrong = predicted != taken || !target_known;
+			if (taken && t.counters[index] < 3)
+				t.counters[index]++;
+			else if (!taken && t.counters[index] > 0)
+				t.counters[index]--;
+			t.history = ((t.history << 1) | taken) & (entries - 1);
+			branches++;
+			branch_mispredicts += wrong;
+		} else if (!is_jr) {
+			wrong = btb_entries > 0 && !btb_hit(t, at, next);
+			if (op_code == op_jal && ras_entries > 0) {
+				t.ras[t.ras_top] = (at + 1) % MEM_SIZE;
+				t.ras_top = (t.ras_top + 1) % ras_entries;
+				t.ras_depth = min(t.ras_depth + 1, ras_entries);
+			}
+			jumps++;
+			jump_mispredicts += wrong;
+		} else {
+			if (ras_entries > 0 && t.ras_depth > 0) {
+				t.ras_top = (t.ras_top + ras_entries - 1) % ras_entries;
+				t.ras_depth--;
+				wrong = t.ras[t.ras_top] != next;
+			} else
+				wrong = btb_entries == 0 || !btb_hit(t, at, next);
+			returns++;
+			return_mispredicts += wrong;
+		}
+		executed[at]++;
+		mispredicted[at] += wrong;
+		return wrong;
+	}
+
+	// Prints the mispredictions by kind of transfer, then by pc
+	void print_stats() const {
+		const string names[] = {"static", "bimodal", "gshare"};
+		cout << fixed << setprecision(2);
+		cout << "Branch predictor " << names[kind] << ", counters " << entries << ", BTB " << btb_entries <<
+			", RAS " << ras_entries << endl;
+		cout << "Branches " << branches << " (mispredicted " << branch_mispredicts << ", " <<
+			(branches ? 100.0 * branch_mispredicts / branches : 0.0) << "%), jumps " << jumps <<
+			" (mispredicted " << jump_mispredicts << "), returns " << returns <<
+			" (mispredicted " << return_mispredicts << ")" << endl;
+		for (size_t at = 0; at < MEM_SIZE; at++) {
+			if (mispredicted[at] > 0)
+				cout << "  pc:" << setw(5) << at << " executed " << executed[at] << ", mispredicted " <<
+					mispredicted[at] << " (" << 100.0 * mispredicted[at] / executed[at] << "%)" << endl;
+		}
+	}
+};
+
+BranchPredictor branch_predictor;
+
+// Causes of pipeline stalls
+enum StallCause { STALL_LOAD_USE, STALL_BRANCH, STALL_MEMORY, NUM_STALL_CAUSES };
+
+// Optional 5-stage in-order pipeline (IF ID EX MEM WB) on top of the cycle model,
+// enabled with --pipeline. Results are forwarded to EX, so only an instruction
+// that reads the register loaded by the lw just before it stalls, for one cycle.
+// j and jal resolve in ID and jeq and jr in EX, flushing what was fetched after
+// a transfer the front end got wrong. Without --predictor it fetches straight on,
+// so every taken transfer is wrong; with one, a correctly predicted taken transfer
+// still loses a cycle to its target unless a BTB or the RAS supplied it. The cycle
+// model's memory stalls hold the pipeline in MEM.
+// Nothing moves through the stages each cycle: each instruction works out its
+// stalls from the one before it when it runs, for a few comparisons per instruction.
+struct PipelineModel {
+	bool enabled = false;
+	int fill = 4;				// cycles before the first instruction reaches WB
+	int jump_penalty = 1;		// j and jal, resolved in ID
+	int branch_penalty = 2;		// jeq and jr, resolved in EX
+	vector<int> load_dst;		// register loaded by the last instruction of each core, or 0
+	long stalls[NUM_STALL_CAUSES] = {};
+	long pc_stalls[NUM_STALL_CAUSES][MEM_SIZE] = {};
+
+	void start(size_t num_cores) {
+		load_dst.assign(num_cores, 0);
+		enabled = true;
+	}
+
+	// Takes the core, the pc and instruction that ran, the pc after it, whether the
+	// front end mispredicted it, and the cycles the memory hierarchy stalled it
+	// Returns the cycles it stalls beyond those
+	long step(size_t core, unsigned at, unsigned instruction, unsigned next, bool redirected, long memory_cycles) {
+		unsigned op_code = instruction >> 13;
+		bool is_jr = op_code == op_jr && (instruction & 15) == 8;
+		unsigned a = (instruction >> 10) & 7;
+		unsigned b = (instruction >> 7) & 7;
+
+		// Register operands read in EX: both sources of the three-register
+		// instructions and jeq, and the first of the rest, except j and jal
+		int loaded = load_dst[core];
+		bool reads_b = op_code == op_jeq || (op_code == 0 && !is_jr);
+		bool load_use = loaded != 0 && op_code != op_j && op_code != op_jal &&
+			((int)a == loaded || (reads_b && (int)b == loaded));
+		load_dst[core] = (op_code == op_lw) ? b : 0;
+
+		long penalty = 0;
+		bool taken = next != (at + 1) % MEM_SIZE;
+		if (redirected)
+			penalty = (op_code == op_jeq || is_jr) ? branch_penalty : jump_penalty;
+		else if (taken && !is_jr && branch_predictor.btb_entries == 0)
+			penalty = jump_penalty;
+
+		if (load_use || penalty > 0 || memory_cycles > 0) {
+			stalls[STALL_LOAD_USE] += load_use;
+			stalls[STALL_BRANCH] += penalty;
+			stalls[STALL_MEMORY] += memory_cycles;
+			pc_stalls[STALL_LOAD_USE][at] += load_use;
+			pc_stalls[STALL_BRANCH][at] += penalty;
+			pc_stalls[STALL_MEMORY][at] += memory_cycles;
+		}
+		return load_use + penalty;
+	}
+
+	// Prints the stall cycles by cause, then by pc
+	void print_stats(long cycles, long instructions) const {
+		cout << fixed << setprecision(2);
+		cout << "Pipeline: cycles " << cycles << ", instructions " << instructions << ", CPI " <<
+			(instructions ? (double)cycles / instructions : 0.0) << ", stall cycles load-use " <<
+			stalls[STALL_LOAD_USE] << ", branch " << stalls[STALL_BRANCH] << ", memory " <<
+			stalls[STALL_MEMORY] << ", fill " << fill << endl;
+		for (size_t at = 0; at < MEM_SIZE; at++) {
+			if (pc_stalls[STALL_LOAD_USE][at] + pc_stalls[STALL_BRANCH][at] + pc_stalls[STALL_MEMORY][at] > 0)
+				cout << "  pc:" << setw(5) << at << " load-use " << pc_stalls[STALL_LOAD_USE][at] <<
+					", branch " << pc_stalls[STALL_BRANCH][at] << ", memory " << pc_stalls[STALL_MEMORY][at] << endl;
+		}
+	}
+};
+
+PipelineModel pipeline;
+
+// Replacement policies of the TLBs
+enum TlbPolicy { TLB_LRU, TLB_FIFO, TLB_RANDOM };
+
+// Set-associative TLB of virtual to physical page numbers
+struct Tlb {
+	string name;
+	size_t entries;
+	size_t assoc;
+	int policy = TLB_LRU;
+	vector<int> vpn;			// virtual page of each entry, or -1
+	vector<unsigned> ppn;
+	vector<long> stamp;			// last use for LRU, fill for FIFO
+	long clock = 0;
+	unsigned random_state = 2463534242u;	// xorshift, so runs repeat exactly
+	long hits = 0;
+	long misses = 0;
+
+	Tlb(const string &name, size_t entries, size_t assoc) : name(name), entries(entries), assoc(assoc),
+		vpn(entries, -1), ppn(entries, 0), stamp(entries, 0) {}
+
+	size_t set_of(unsigned page) const {
+		return page % (entries / assoc) * assoc;
+	}
+
+	// Takes a virtual page
+	// Returns the index of its entry, or -1, counting the hit or miss
+	int find(unsigned page) {
+		size_t set = set_of(page);
+		for (size_t i = set; i < set + assoc; i++) {
+			if (vpn[i] == (int)page) {
+				hits++;
+				if (policy == TLB_LRU)
+					stamp[i] = ++clock;
+				return i;
+			}
+		}
+		misses++;
+		return -1;
+	}
 
-			// If no free blocks in L2 cache
-			if (!written) {
-				int LRU_data = L2MRU[L2row].front();
+	// Takes a virtual page and its physical page, and puts them in a free entry of
+	// the set or in place of the one the policy picks
+	void insert(unsigned page, unsigned frame) {
+		size_t set = set_of(page);
+		size_t victim = set;
+		for (size_t i = set; i < set + assoc; i++) {
+			if (vpn[i] == -1) {
+				victim = i;
+				break;
+			}
+			if (stamp[i] < stamp[victim])
+				victim = i;
+		}
+		if (vpn[victim] != -1 && policy == TLB_RANDOM) {
+			random_state ^= random_state << 13;
+			random_state ^= random_state >> 17;
+			random_state ^= random_state << 5;
+			victim = set + random_state % assoc;
+		}
+		vpn[victim] = page;
+		ppn[victim] = frame;
+		stamp[victim] = ++clock;
+	}
 
-				// Write to L2 cache
-				L2cache[LRU_data][2] = L2tag;
-				L2blockdata[LRU_data] = blockdata_for_L2;
+	void invalidate(unsigned page) {
+		size_t set = set_of(page);
+		for (size_t i = set; i < set + assoc; i++) {
+			if (vpn[i] == (int)page)
+				vpn[i] = -1;
+		}
+	}
+};
+
+// Optional paging of the addresses of loads and stores, enabled with --paging. The
+// TLBs sit in front of L1, first level first. By default every page maps to itself
+// through a table kept outside simulated memory, so a walk reads nothing. With
+// --page-table the table holds one word per virtual page at table_base in simulated
+// memory, which the program fills with stores: the valid bit PTE_VALID and the
+// physical page number. A walk then reads the entry through the caches, which shows
+// up in the log and the cache statistics like any other, and an invalid entry is a
+// page fault, which maps the page to itself. Instruction fetches aren't translated,
+// since they don't go through the caches.
+struct PagingModel {
+	bool enabled = false;
+	unsigned page_words = 256;			// a power of two
+	bool in_memory = false;				// the table is at table_base, from --page-table
+	unsigned table_base = 0;
+	vector<Tlb> tlbs;
+	long walks = 0;
+	vector<long> walks_served;			// walks whose entry each cache level read, memory last
+	long faults = 0;
+	long accesses[MEM_SIZE] = {};		// translations by pc
+	long walked[MEM_SIZE] = {};			// walks by pc
+
+	static const unsigned PTE_VALID = 1 << 15;
+
+	unsigned pages() const {
+		return MEM_SIZE / page_words;
+	}
+
+	void start() {
+		walks_served.assign(levels.size() + 1, 0);
+		enabled = true;
+	}
 
-				print_log_entry("L2", "SW", pc, pointer, L2row);
-				updateMRU(2, L2row, LRU_data, assoc2);
+	// Takes the virtual address of a load or store by the instruction at pc
+	// Returns its physical address, looking it up in the TLBs and walking the page
+	// table if they all miss
+	unsigned translate(unsigned addr) {
+		unsigned page = addr / page_words;
+		accesses[pc]++;
+		for (size_t level = 0; level < tlbs.size(); level++) {
+			int index = tlbs[level].find(page);
+			if (index != -1) {
+				unsigned frame = tlbs[level].ppn[index];
+				for (size_t above = 0; above < level; above++)
+					tlbs[above].insert(page, frame);
+				return frame * page_words + addr % page_words;
 			}
 		}
 
+		walks++;
+		walked[pc]++;
+		unsigned frame = page;
+		if (in_memory) {
+			unsigned entry = cache_read(table_base + page);
+			walks_served[last_read_level == 0 ? levels.size() : last_read_level - 1]++;
+			issue_prefetches();
+			if (entry & PTE_VALID)
+				frame = (entry & ~PTE_VALID) % pages();
+			else
+				faults++;
+		}
+		for (Tlb &tlb : tlbs)
+			tlb.insert(page, frame);
+		return frame * page_words + addr % page_words;
+	}
+
+	// Takes the physical address of a store
+	// Drops the TLB entries of the page whose table entry it overwrote
+	void note_store(unsigned addr) {
+		if (in_memory && addr >= table_base && addr < table_base + pages()) {
+			for (Tlb &tlb : tlbs)
+				tlb.invalidate(addr - table_base);
+		}
+	}
+
+	// Prints the hits and misses of each TLB, the walks by the level that served them,
+	// then the translations and walks by pc
+	void print_stats() const {
+		cout << fixed << setprecision(2);
+		cout << "Paging pages " << pages() << " of " << page_words << " words, page table ";
+		if (in_memory)
+			cout << "at " << table_base << endl;
+		else
+			cout << "outside memory, mapping every page to itself" << endl;
+		for (const Tlb &tlb : tlbs) {
+			long lookups = tlb.hits + tlb.misses;
+			cout << tlb.name << " entries " << tlb.entries << ", associativity " << tlb.assoc << ", hits " <<
+				tlb.hits << ", misses " << tlb.misses << " (" << (lookups ? 100.0 * tlb.misses / lookups : 0.0) <<
+				"%)" << endl;
+		}
+		cout << "Page walks " << walks << ", page faults " << faults;
+		if (in_memory) {
+			cout << ", walk reads served by";
+			for (size_t level = 0; level < levels.size(); level++)
+				cout << " " << levels[level].name << " " << walks_served[level] << ",";
+			cout << " memory " << walks_served[levels.size()];
+		}
+		cout << endl;
+		for (size_t at = 0; at < MEM_SIZE; at++) {
+			if (walked[at] > 0)
+				cout << "  pc:" << setw(5) << at << " translations " << accesses[at] << ", walks " <<
+					walked[at] << " (" << 100.0 * walked[at] / accesses[at] << "%)" << endl;
+		}
+	}
+};
+
+PagingModel paging;
+
+// Takes a memory address read by the core running on this thread
+// Returns the word as the core sees it during the quantum: its own latest store
+// to the address, or else memory[] as it was at the start of the quantum
+unsigned core_word(unsigned pointer) {
+	auto it = parallel_core->store_buffer.find(pointer);
+	return (it != parallel_core->store_buffer.end()) ? it->second : memory[pointer];
+}
+
+// Takes a memory address loaded by the core running on this thread
+// A hit in the core's L1 is handled here; every access is queued for the coordinator.
+// Returns the loaded value
+unsigned parallel_load(unsigned pointer) {
+	Core &core = *parallel_core;
+	CacheLevel &L1 = core.L1;
+	CoreEvent event = {core.step, pc, pointer, 0, false, false};
+
+	int index = L1.find(pointer);
+	if (index != -1 && L1.prefetcher == PF_NONE) {
+		L1.read_hits++;
+		L1.touch(index);
+		event.handled = true;
+	}
+	event_queues[&core - &cores[0]].push(event);
+	return core_word(pointer);
+}
+
+// Takes a memory address and the value the core running on this thread stores to it
+// The store goes to the core's store buffer. A write-back L1 that holds the block
+// exclusively takes the write here; every store is queued for the coordinator.
+void parallel_store(unsigned pointer, unsigned value) {
+	Core &core = *parallel_core;
+	CacheLevel &L1 = core.L1;
+	CoreEvent event = {core.step, pc, pointer, value, true, false};
+
+	core.store_buffer[pointer] = value;
+	int index = L1.find(pointer);
+	if (index != -1 && L1.lines[index].exclusive && L1.write_back && L1.prefetcher == PF_NONE) {
+		L1.write_hits++;
+		L1.touch(index);
+		if (!tag_only)
+			L1.blockdata[index][L1.offset_of(pointer)] = value;
+		L1.lines[index].dirty = true;
+		event.handled = true;
+	}
+	event_queues[&core - &cores[0]].push(event);
+}
+
+/*
+	Decoded engine
+
+	--engine fast decodes each word of machine code once into a DecodedInstruction
+	and runs it from there, decoding it again after a store overwrites it.
+*/
+
+// Operations of decoded instructions. A register write to $0 decodes to NOP.
+enum DecodedOp { D_NOP, D_ADD, D_SUB, D_OR, D_AND, D_SLT, D_JR, D_SLTI, D_LW, D_SW, D_JEQ, D_ADDI,
+	D_J, D_JAL, D_INVALID };
+
+// Instruction decoded once for --engine fast, with its immediate already sign-extended
+struct DecodedInstruction {
+	unsigned char op = D_INVALID;
+	unsigned char a = 0;		// regSrcA
+	unsigned char b = 0;		// regSrcB, or the register stored by sw
+	unsigned char dst = 0;
+	unsigned imm = 0;
+	bool valid = false;			// false until the word at this address is decoded
+};
+
+bool fast_engine = false;	// set by --engine fast
+DecodedInstruction decoded[MEM_SIZE];
+
+// Takes an address that was just written
+// Forgets its decoded instruction, so code that writes itself is decoded again
+inline void invalidate_decoded(unsigned pointer) {
+	decoded[pointer].valid = false;
+}
+
+// Takes a word of machine code and decodes it the way execute_instruction reads it
+DecodedInstruction decode_instruction(unsigned instruction) {
+	DecodedInstruction d;
+	unsigned op_code = find_opcode(instruction);
+	d.a = (instruction >> 10) & 7;
+	d.b = (instruction >> 7) & 7;
+	d.valid = true;
+	int imm = instruction & 127;
+	if (imm > 63)
+		imm = to_signed_binary(imm);
+
+	if (op_code == 0) {
+		const unsigned char ops[16] = {D_ADD, D_SUB, D_OR, D_AND, D_SLT, D_INVALID, D_INVALID, D_INVALID,
+			D_JR, D_INVALID, D_INVALID, D_INVALID, D_INVALID, D_INVALID, D_INVALID, D_INVALID};
+		d.op = ops[instruction & 15];
+		d.dst = (instruction >> 4) & 7;
+		if (d.op != D_JR && d.op != D_INVALID && d.dst == 0)
+			d.op = D_NOP;
+	} else if (op_code == op_slti) {
+		d.op = (d.b == 0) ? D_NOP : D_SLTI;
+		d.dst = d.b;
+		d.imm = instruction & 127;
+		if (d.imm > 63)
+			d.imm |= 65408;		// sign extended to 16 bits, compared unsigned
+	} else if (op_code == op_lw || op_code == op_sw || op_code == op_addi) {
+		d.op = (op_code == op_lw) ? D_LW : (op_code == op_sw) ? D_SW : (d.b == 0) ? D_NOP : D_ADDI;
+		d.dst = d.b;
+		d.imm = imm;
+	} else if (op_code == op_jeq) {
+		d.op = D_JEQ;
+		d.imm = 1 + imm;
+	} else {
+		d.op = (op_code == op_j) ? D_J : D_JAL;
+		d.imm = instruction & 8191;
+	}
+	return d;
+}
+
+// Takes the address of a load
+// Runs it through the profiler and the cache model
+// Returns the loaded word
+unsigned simulate_load(unsigned pointer) {
+	if (reuse_profile.enabled)
+		reuse_profile.access(pc, pointer);
+	if (parallel_core != nullptr)
+		return parallel_load(pointer);
+	if (host_pipeline) {
+		// memory[] holds the latest values, which is what the caches would return
+		reference_ring.push({pc, pointer, 0, REF_LOAD});
+		return memory[pointer];
+	}
+
+	/*Start of cache simulation*/
+	long words_read = mem_words_read;
+	long words_written = mem_words_written;
+
+	if (paging.enabled)
+		pointer = paging.translate(pointer);
+	unsigned value = cache_read(pointer);
+
+	if (timing.enabled)
+		timing_load(mem_words_read - words_read, mem_words_written - words_written);
+	issue_prefetches();
+	return value;
+}
+
+// Takes the address and value of a store
+// Writes memory and runs the store through the profiler and the cache model
+void simulate_store(unsigned pointer, unsigned value) {
+	if (reuse_profile.enabled)
+		reuse_profile.access(pc, pointer);
+	if (parallel_core != nullptr) {
+		parallel_store(pointer, value);
+		return;
+	}
+
+	/*Start of cache simulation*/
+	long words_read = mem_words_read;
+	long words_written = mem_words_written;
+	if (paging.enabled) {
+		pointer = paging.translate(pointer);
+		paging.note_store(pointer);
+	}
+
+	store_word(pointer, value);
+	invalidate_decoded(pointer);
+	if (host_pipeline) {
+		reference_ring.push({pc, pointer, value, REF_STORE});
+		return;
+	}
+
+	cache_write(pointer);
+
+	if (timing.enabled)
+		timing_store(mem_words_read - words_read, mem_words_written - words_written);
+}
+
+// Prints that the instruction at pc is invalid, after the log entries of the
+// instructions before it
+void report_invalid_instruction() {
+	if (host_pipeline)
+		reference_ring.push({pc, 0, 0, REF_INVALID});
+	else
+		cout << "invalid instruction at pc: " << pc << endl;
+}
+
+// Takes an unsigned int representing an E20 instruction
+// Returns true if the instruction executed is halt
+// Performs the instruction and updates the global pc and registers variable accordingly
+bool execute_instruction(unsigned instruction) {
+	unsigned op_code = find_opcode(instruction);
+	unsigned regSrcA;
+	unsigned regSrcB;
+	unsigned regDst;
+	int imm;
+	// cout << "pc: " << pc << endl;
+
+	if (op_code == op_add && ((instruction & 15) == 0)) {	// check opcode and least sig 4 bits
+		regSrcA = (instruction >> 10) & 7;	// isolate least significant 3 bits
+		regSrcB = (instruction >> 7) & 7;
+		regDst = (instruction >> 4) & 7;
+
+		if (regDst != 0)	// if we are not modifying register 0
+			registers[regDst] = (registers[regSrcA] + registers[regSrcB]) & 65535;	// trim result to 16 bits
+
+		increment_pc();
+		return false;
+	}
+
+	else if (op_code == op_sub && ((instruction & 15) == 1)) {
+		regSrcA = (instruction >> 10) & 7;
+		regSrcB = (instruction >> 7) & 7;
+		regDst = (instruction >> 4) & 7;
+
+		if (regDst != 0)
+			registers[regDst] = (registers[regSrcA] - registers[regSrcB]) & 65535;
+
+		increment_pc();
+		return false;
+	}
+
+	else if (op_code == op_or && ((instruction & 15) == 2)) {
+		regSrcA = (instruction >> 10) & 7;
+		regSrcB = (instruction >> 7) & 7;
+		regDst = (instruction >> 4) & 7;
+
+		if (regDst != 0)
+			registers[regDst] = (registers[regSrcA] | registers[regSrcB]) & 65535;
+
+		increment_pc();
+		return false;
+	}
+
+	else if (op_code == op_and && ((instruction & 15) == 3)) {
+		regSrcA = (instruction >> 10) & 7;
+		regSrcB = (instruction >> 7) & 7;
+		regDst = (instruction >> 4) & 7;
+
+		if (regDst != 0)
+			registers[regDst] = (registers[regSrcA] & registers[regSrcB]) & 65535;
+
+		increment_pc();
+		return false;
+	}
+
+	else if (op_code == op_slt && ((instruction & 15) == 4)) {
+		regSrcA = (instruction >> 10) & 7;
+		regSrcB = (instruction >> 7) & 7;
+		regDst = (instruction >> 4) & 7;
+
+		if (regDst != 0) {
+			if (registers[regSrcA] < registers[regSrcB])
+				registers[regDst] = 1;
+			else
+				registers[regDst] = 0;
+		}
+
+		increment_pc();
+		return false;
+	}
+
+	else if (op_code == op_jr && ((instruction & 15) == 8)) {
+		regSrcA = (instruction >> 10) & 7;
+		set_pc(registers[regSrcA]);
+		return false;
+	}
+
+	else if (op_code == op_slti) {
+		regSrcA = (instruction >> 10) & 7;
+		regDst = (instruction >> 7) & 7;
+		imm = instruction & 127;	// isolate least significant 7 bits
+
+		if (imm > 63)			// if 7th most sig bit is 1, then
+			imm = imm | 65408;	// sign extend 7 bit immediate to 16 bits (using 1111111110000000 mask)
+
+		if (regDst != 0) {
+			if (registers[regSrcA] < imm)
+				registers[regDst] = 1;
+			else
+				registers[regDst] = 0;
+		}
+
+		increment_pc();
+		return false;
+	}
+
+	else if (op_code == op_lw) {
+		regSrcA = (instruction >> 10) & 7;
+		regDst = (instruction >> 7) & 7;
+		imm = instruction & 127;
+
+		if (imm > 63)	// if 7th most sig bit is 1, then negate
+			imm = to_signed_binary(imm);
+
+		unsigned pointer = (registers[regSrcA] + imm) & 8191;	// only care about least sig 13 bits
+		// mask will ensure the pointer points to a valid memory address (it will always be < 8192)
+
+		unsigned value = simulate_load(pointer);
+		if (regDst != 0)
+			registers[regDst] = value;
+
+		increment_pc();
+		return false;
+	}
+
+	else if (op_code == op_sw) {
+		regSrcA = (instruction >> 10) & 7;
+		regDst = (instruction >> 7) & 7;
+		imm = instruction & 127;
+
+		if (imm > 63)
+			imm = to_signed_binary(imm);
+
+		unsigned pointer = (registers[regSrcA] + imm) & 8191;
+
+		simulate_store(pointer, registers[regDst]);
+
 		increment_pc();
 		return false;
 	}
@@ -583,61 +2688,919 @@ bool execute_instruction(unsigned instruction, int blocks1, int assoc1, int bloc
 		else
 			increment_pc();
 
-		return false;
+		return false;
+	}
+
+	else if (op_code == op_addi) {
+		regSrcA = (instruction >> 10) & 7;
+		regDst = (instruction >> 7) & 7;
+		imm = instruction & 127;
+
+		if (imm > 63)
+			imm = to_signed_binary(imm);
+
+		if (regDst != 0)
+			registers[regDst] = (registers[regSrcA] + imm) & 65535;
+
+		increment_pc();
+		return false;
+	}
+
+	else if (op_code == op_j) {
+		imm = instruction & 8191;	// isolate least significant 13 bits
+
+		if (pc == imm)	// if instruction is halt, do nothing to pc
+			return true;
+		else {
+			set_pc(imm);
+			return false;
+		}
+	}
+
+	else if (op_code == op_jal) {
+		imm = instruction & 8191;
+
+		registers[7] = pc + 1;
+		set_pc(imm);
+		return false;
+	}
+
+	else {
+		report_invalid_instruction();
+		return false;
+	}
+}
+
+bool machine_halted = false;	// set once the only core, or every core, has halted
+size_t next_core = 0;			// core whose turn is next in the round-robin
+
+// Runs the instruction at pc like execute_instruction, from its decoded form
+// Returns true if it is halt
+bool execute_decoded() {
+	if (!decoded[pc].valid)
+		decoded[pc] = decode_instruction(memory[pc]);
+	const DecodedInstruction d = decoded[pc];	// a store may overwrite it
+	unsigned *r = registers;
+
+	switch (d.op) {
+	case D_NOP:
+		break;
+	case D_ADD:
+		r[d.dst] = (r[d.a] + r[d.b]) & 65535;
+		break;
+	case D_SUB:
+		r[d.dst] = (r[d.a] - r[d.b]) & 65535;
+		break;
+	case D_OR:
+		r[d.dst] = r[d.a] | r[d.b];
+		break;
+	case D_AND:
+		r[d.dst] = r[d.a] & r[d.b];
+		break;
+	case D_SLT:
+		r[d.dst] = r[d.a] < r[d.b];
+		break;
+	case D_SLTI:
+		r[d.dst] = r[d.a] < d.imm;
+		break;
+	case D_ADDI:
+		r[d.dst] = (r[d.a] + d.imm) & 65535;
+		break;
+	case D_LW: {
+		unsigned value = simulate_load((r[d.a] + d.imm) & 8191);
+		if (d.dst != 0)
+			r[d.dst] = value;
+		break;
+	}
+	case D_SW:
+		simulate_store((r[d.a] + d.imm) & 8191, r[d.b]);
+		break;
+	case D_JEQ:
+		pc = (r[d.a] == r[d.b]) ? (pc + d.imm) % MEM_SIZE : (pc + 1) % MEM_SIZE;
+		return false;
+	case D_JR:
+		pc = r[d.a] % MEM_SIZE;
+		return false;
+	case D_J:
+		if (pc == d.imm)	// halt
+			return true;
+		pc = d.imm;
+		return false;
+	case D_JAL:
+		r[7] = pc + 1;
+		pc = d.imm;
+		return false;
+	default:
+		report_invalid_instruction();
+		return false;
+	}
+
+	pc = (pc + 1) % MEM_SIZE;
+	return false;
+}
+
+// Takes the instruction at pc
+// Runs it on the engine chosen with --engine
+// Returns true if it is halt
+inline bool execute(unsigned instruction) {
+	return fast_engine ? execute_decoded() : execute_instruction(instruction);
+}
+
+// Takes the number of the running core, 0 with a single core
+// Runs the instruction at pc, recording it in execution_profile
+// Returns true if it halted
+bool execute_profiled(size_t core) {
+	ExecutionProfile &profile = execution_profile;
+	unsigned at = pc;
+	unsigned instruction = memory[at];
+	unsigned op_code = find_opcode(instruction);
+	profile.executed[at]++;
+
+	if (op_code == op_lw || op_code == op_sw) {
+		long misses = levels[0].read_misses + levels[0].write_misses;
+		bool halted = execute(instruction);
+		profile.misses[at] += levels[0].read_misses + levels[0].write_misses - misses;
+		return halted;
+	}
+	if (op_code == op_jeq) {
+		bool equal = registers[(instruction >> 10) & 7] == registers[(instruction >> 7) & 7];
+		(equal ? profile.taken : profile.not_taken)[at]++;
+	}
+	bool halted = execute(instruction);
+	if (op_code == op_jal || (op_code == 0 && (instruction & 15) == 8)) {
+		// The instruction isn't counted yet in simulate_instruction
+		long ran = ((cores.size() <= 1) ? timing.instructions : cores[core].instructions) + 1;
+		if (op_code == op_jal)
+			profile.call(core, ran, pc);
+		else
+			profile.ret(core, ran);	// jr
+	}
+	return halted;
+}
+
+// Takes the number of the running core, 0 with a single core
+// Runs the instruction at pc through the profiler, the branch predictor and the
+// pipeline model, when enabled
+// Returns true if it halted
+bool execute_observed(size_t core) {
+	unsigned at = pc;
+	unsigned instruction = memory[at];
+	long cycles = timing.cycles;
+	bool halted = execution_profile.enabled ? execute_profiled(core) : execute(instruction);
+
+	// Without a predictor the front end fetches straight on
+	bool redirected = branch_predictor.enabled ? branch_predictor.resolve(core, at, instruction, pc) :
+		pc != (at + 1) % MEM_SIZE;
+	if (pipeline.enabled && !halted)
+		timing.cycles += pipeline.step(core, at, instruction, pc, redirected, timing.cycles - cycles);
+	return halted;
+}
+
+// Set when an instruction goes through execute_observed
+bool observe_instructions = false;
+
+// Runs one instruction: the program's, or the next running core's in round-robin order.
+// A halted core stays on its halt instruction and is skipped.
+// Returns false, without running anything, once everything has halted
+bool simulate_instruction() {
+	if (machine_halted)
+		return false;
+
+	if (cores.size() <= 1) {
+		machine_halted = observe_instructions ? execute_observed(0) : execute(memory[pc]);
+		timing.instructions++;
+		timing.cycles++;
+		return true;
+	}
+
+	while (cores[next_core].halted)
+		next_core = (next_core + 1) % cores.size();
+	size_t id = next_core;
+	switch_core(id);
+	if (observe_instructions ? execute_observed(id) : execute(memory[pc])) {
+		cores[id].halted = true;
+		machine_halted = all_of(cores.begin(), cores.end(), [](const Core &core) { return core.halted; });
+	}
+	cores[id].instructions++;
+	timing.instructions++;
+	timing.cycles++;
+
+	next_core = (id + 1) % cores.size();
+	return true;
+}
+
+// Takes a core that is not halted
+// Runs it for one quantum on this thread, against its private state only
+void run_quantum(Core &core) {
+	parallel_core = &core;
+	pc = core.pc;
+	copy(begin(core.registers), end(core.registers), begin(registers));
+	core.store_buffer.clear();
+
+	for (core.step = 0; core.step < quantum && !core.halted; core.step++) {
+		if (execute_instruction(core_word(pc)))
+			core.halted = true;
+		core.instructions++;
+	}
+
+	core.pc = pc;
+	copy(begin(registers), end(registers), begin(core.registers));
+	parallel_core = nullptr;
+}
+
+// Replays the events the cores queued during the last quantum, in the order the
+// round-robin interleaving would have made the accesses: by instruction number,
+// then by core. Stores reach memory[] here, and accesses the threads left to the
+// coordinator go through the whole hierarchy, including coherence.
+void replay_quantum() {
+	for (long step = 0; step < quantum; step++) {
+		for (size_t id = 0; id < cores.size(); id++) {
+			const CoreEvent *event = event_queues[id].front();
+			if (event == nullptr || event->step != step)
+				continue;
+
+			switch_core(id);
+			unsigned core_pc = pc;
+			pc = event->pc;
+			CacheLevel &L1 = levels[0];
+			int index = L1.find(event->addr);
+
+			if (!event->store) {
+				if (event->handled) {
+					classify_access(L1, event->addr, false);
+					print_log_entry(L1, false, LOG_HIT, pc, event->addr, L1.row_of(event->addr));
+				} else {
+					cache_read(event->addr);
+					issue_prefetches();
+				}
+			} else {
+				store_word(event->addr, event->value);
+				invalidate_decoded(event->addr);
+				if (event->handled && index != -1 && L1.lines[index].exclusive) {
+					// The block may have been refilled from memory[] since the thread wrote it
+					if (!tag_only)
+						L1.blockdata[index][L1.offset_of(event->addr)] = event->value;
+					L1.lines[index].dirty = true;
+					classify_access(L1, event->addr, false);
+					print_log_entry(L1, false, LOG_SW, pc, event->addr, L1.row_of(event->addr));
+				} else {
+					// Another core took the block earlier in the quantum, so replay the store in full
+					if (event->handled)
+						L1.write_hits--;
+					cache_write(event->addr);
+				}
+			}
+
+			pc = core_pc;
+			event_queues[id].pop();
+		}
+	}
+
+	// Park the last core again before its thread runs the next quantum
+	switch_core(cores.size());
+}
+
+// Runs the cores on num_threads host threads, each running a fixed share of the cores.
+// The threads run a quantum, meet at a barrier, and wait while the main thread replays
+// the quantum's events, so the results only depend on the quantum, not on the threads.
+void run_cores_parallel() {
+	// Park the running core so every core's state is in cores[]
+	switch_core(cores.size());
+	for (size_t id = 0; id < cores.size(); id++)
+		event_queues.emplace_back().reserve(quantum);
+
+	Barrier start(num_threads + 1);
+	Barrier done(num_threads + 1);
+	bool finished = false;
+	vector<thread> workers;
+	for (int t = 0; t < num_threads; t++) {
+		workers.emplace_back([&, t] {
+			while (true) {
+				start.wait();
+				if (finished)
+					return;
+				for (size_t id = t; id < cores.size(); id += num_threads) {
+					if (!cores[id].halted)
+						run_quantum(cores[id]);
+				}
+				done.wait();
+			}
+		});
+	}
+
+	auto begin_time = chrono::steady_clock::now();
+	while (any_of(cores.begin(), cores.end(), [](const Core &core) { return !core.halted; })) {
+		start.wait();
+		done.wait();
+		replay_quantum();
+		quanta++;
+	}
+	finished = true;
+	start.wait();
+	for (thread &worker : workers)
+		worker.join();
+	parallel_seconds = chrono::duration<double>(chrono::steady_clock::now() - begin_time).count();
+
+	for (const Core &core : cores) {
+		timing.instructions += core.instructions;
+		timing.cycles += core.instructions;
+	}
+	machine_halted = true;
+}
+
+// Runs the cache model on the references queued by the interpreter, until it halts.
+// The model keeps its own copy of memory[] up to date from the stores, since the
+// interpreter may already have run past them.
+void run_cache_model() {
+	vector<unsigned> model_copy(memory, memory + MEM_SIZE);
+	model_memory = model_copy.data();
+	while (true) {
+		MemoryReference reference = reference_ring.front();
+		reference_ring.pop();
+		pc = reference.pc;
+		if (reference.kind == REF_LOAD) {
+			cache_read(reference.addr);
+			issue_prefetches();
+		} else if (reference.kind == REF_STORE) {
+			model_memory[reference.addr] = reference.value;
+			cache_write(reference.addr);
+		} else if (reference.kind == REF_INVALID) {
+			if (log_enabled)
+				log_ring.push({LOG_INVALID, LOG_SW, 0, false, (int) pc, 0, 0, ""});
+			else
+				cout << "invalid instruction at pc: " << pc << endl;
+		} else
+			break;
+	}
+	if (log_enabled) {
+		log_ring.push({LOG_END, LOG_SW, 0, false, 0, 0, 0, ""});
+		log_ring.flush();
+	}
+	model_memory = memory;
+}
+
+// Prints the log entries queued by the cache model, until it finishes
+void run_log_writer() {
+	while (true) {
+		LogRecord &record = log_ring.front();
+		if (record.kind == LOG_END)
+			break;
+		if (record.kind == LOG_INVALID)
+			cout << "invalid instruction at pc: " << record.pc << endl;
+		else if (record.victim)
+			write_log_entry(victim_name(levels[record.level]), record.status, record.pc, record.addr,
+				record.row, record.detail);
+		else
+			write_log_entry(levels[record.level].name, record.status, record.pc, record.addr,
+				record.row, record.detail);
+		log_ring.pop();
+	}
+	log_ring.pop();
+}
+
+// Runs the program with the interpreter on this thread, the cache model on another and
+// the log writer on a third, connected by PipeRings. The model and the writer see the
+// references and entries in program order, so the output is the same as running them
+// one after the other. The stages only overlap on a host with a free core for each;
+// on one CPU the handoffs make the run slightly slower than running them in turn.
+void run_host_pipeline() {
+	host_pipeline = true;
+	thread cache_model(run_cache_model);
+	thread log_writer;
+	if (log_enabled)
+		log_writer = thread(run_log_writer);
+
+	while (simulate_instruction()) {}
+	reference_ring.push({pc, 0, 0, REF_END});
+	reference_ring.flush();
+	cache_model.join();
+	if (log_writer.joinable())
+		log_writer.join();
+	host_pipeline = false;
+}
+
+// Takes a string and splits it into the values separated by commas
+vector<string> split_list(const string &list) {
+	vector<string> values;
+	size_t pos;
+	size_t lastpos = 0;
+	while ((pos = list.find(",", lastpos)) != string::npos) {
+		values.push_back(list.substr(lastpos, pos - lastpos));
+		lastpos = pos + 1;
+	}
+	values.push_back(list.substr(lastpos));
+	return values;
+}
+
+// Takes the name of a per-cache option ("--write-policy", "--write-alloc" or
+// "--prefetch") and the value to apply to a cache level
+// Returns false if the value is not valid for the option
+bool set_cache_option(const string &option, const string &value, CacheLevel &cache) {
+	const string prefetchers[] = {"none", "nextline", "stride", "stream"};
+
+	if (option == "--write-policy" && (value == "wt" || value == "wb"))
+		cache.write_back = (value == "wb");
+	else if (option == "--write-alloc" && (value == "alloc" || value == "noalloc"))
+		cache.write_allocate = (value == "alloc");
+	else if (option == "--prefetch") {
+		int kind = find(begin(prefetchers), end(prefetchers), value) - begin(prefetchers);
+		if (kind == PF_STREAM + 1)
+			return false;
+		cache.prefetcher = kind;
+		cache.stride_table.assign(STRIDE_TABLE_SIZE, StrideEntry());
+		cache.stream_table.assign(STREAM_TABLE_SIZE, StreamEntry());
+	}
+	else
+		return false;
+	return true;
+}
+
+// Takes the name of a per-cache option and its comma-separated list of values
+// Applies the values to each level in order, or a single value to all of them.
+// Returns false if the list is malformed
+bool set_cache_options(const string &option, const string &list) {
+	if (list.size() == 0)
+		return true;
+
+	vector<string> values = split_list(list);
+	if (values.size() != 1 && values.size() != levels.size())
+		return false;
+
+	for (size_t level = 0; level < levels.size(); level++) {
+		if (!set_cache_option(option, values[values.size() == 1 ? 0 : level], levels[level]))
+			return false;
+	}
+	return true;
+}
+
+// Takes a level spec: size,associativity,blocksize followed by any of the options
+// wt, wb, alloc, noalloc, nine, inclusive, exclusive, none, nextline, stride and stream
+// Adds the level below the levels configured so far.
+// Returns false if the spec is malformed
+bool add_cache_level(const string &spec) {
+	vector<string> values = split_list(spec);
+	if (values.size() < 3)
+		return false;
+
+	int geometry[3];
+	for (int i = 0; i < 3; i++) {
+		if (values[i].size() == 0 || values[i].find_first_not_of("0123456789") != string::npos)
+			return false;
+		geometry[i] = stoi(values[i]);
+	}
+	if (geometry[1] < 1 || geometry[2] < 1 || geometry[0] < geometry[1] * geometry[2])
+		return false;
+
+	CacheLevel cache("L" + to_string(levels.size() + 1), geometry[0], geometry[1], geometry[2]);
+	for (size_t i = 3; i < values.size(); i++) {
+		const string &value = values[i];
+		if (value == "nine" || value == "inclusive" || value == "exclusive")
+			cache.mode = (value == "nine") ? MODE_NINE : (value == "inclusive") ? MODE_INCLUSIVE : MODE_EXCLUSIVE;
+		else if (!set_cache_option("--write-policy", value, cache) &&
+				!set_cache_option("--write-alloc", value, cache) &&
+				!set_cache_option("--prefetch", value, cache))
+			return false;
+	}
+
+	levels.push_back(cache);
+	return true;
+}
+
+// Takes the name of a file with one level spec per line, top level first.
+// Blank lines and anything after a '#' are ignored.
+// Appends the specs to specs and returns false if the file can't be read
+bool read_cache_file(const string &filename, vector<string> &specs) {
+	ifstream f(filename);
+	if (!f.is_open())
+		return false;
+
+	string line;
+	while (getline(f, line)) {
+		line = line.substr(0, line.find("#"));
+		line.erase(remove_if(line.begin(), line.end(), ::isspace), line.end());
+		if (line.size() > 0)
+			specs.push_back(line);
+	}
+	return true;
+}
+
+bool show_stats = false;	// set by --stats
+
+// Measured for --bench
+bool show_bench = false;
+size_t loaded_words = 0;
+double load_seconds = 0;
+double run_seconds = 0;
+
+// Final state checks
+bool show_final_hash = false;	// set by --final-hash
+bool check_final_hash = false;	// set by --expect-hash
+uint64_t expected_hash = 0;
+size_t dump_words = 0;			// words of memory --dump-state prints
+
+// Takes the number of a core, 0 with a single core
+// Returns its pc and registers, wherever they are kept
+const unsigned *core_state(size_t id, unsigned &core_pc) {
+	if (cores.size() <= 1 || id == current_core) {
+		core_pc = pc;
+		return registers;
+	}
+	core_pc = cores[id].pc;
+	return cores[id].registers;
+}
+
+// Returns the hash of the final state: memory_digest and the pc and registers of
+// every core
+uint64_t final_state_hash() {
+	uint64_t hash = hash_mix(HASH_START, memory_digest);
+	for (size_t id = 0; id < max<size_t>(cores.size(), 1); id++) {
+		unsigned core_pc;
+		const unsigned *regs = core_state(id, core_pc);
+		hash = hash_mix(hash, core_pc);
+		for (size_t i = 0; i < NUM_REGS; i++)
+			hash = hash_mix(hash, regs[i]);
+	}
+	return hash;
+}
+
+// Takes a hash and returns it as 16 hex digits
+string hash_text(uint64_t hash) {
+	char text[17];
+	snprintf(text, sizeof(text), "%016llx", (unsigned long long)hash);
+	return text;
+}
+
+// Takes the number of words of memory to print
+// Prints the final state of every core, with memory after the last
+void print_final_state(size_t memquantity) {
+	size_t count = max<size_t>(cores.size(), 1);
+	for (size_t id = 0; id < count; id++) {
+		unsigned core_pc;
+		const unsigned *regs = core_state(id, core_pc);
+		if (count > 1)
+			cout << "Core " << id << " ";
+		print_state(core_pc, regs, memory, (id + 1 == count) ? memquantity : 0);
+	}
+}
+
+// Runs the program until it halts, on host threads if --threads or --host-pipeline was given
+void run_simulation() {
+	auto run_start = chrono::steady_clock::now();
+	if (cores.size() > 1 && num_threads > 0)
+		run_cores_parallel();
+	else if (use_host_pipeline)
+		run_host_pipeline();
+	else
+		while (simulate_instruction()) {}
+	run_seconds += chrono::duration<double>(chrono::steady_clock::now() - run_start).count();
+}
+
+// What one instruction did, as compared by --lockstep
+struct LockstepRecord {
+	long step = 0;
+	unsigned core = 0;
+	unsigned pc = 0;
+	unsigned instruction = 0;
+	unsigned registers[NUM_REGS] = {};
+	unsigned stored = 0;		// the word at the address a sw wrote, after it ran
+	unsigned halted = 0;
+	unsigned unused = 0;		// fills what would be padding, since records are compared bytewise
+	uint64_t events = 0;		// hash of the cache events the instruction logged
+	uint64_t memory = 0;		// memory_digest after the instruction
+	uint64_t checkpoint = 0;	// hash_memory(memory) at a checkpoint, otherwise 0
+};
+static_assert(has_unique_object_representations_v<LockstepRecord>, "LockstepRecord has padding");
+
+// Records the fast engine of --lockstep writes to the pipe at once, at most
+size_t const static LOCKSTEP_BATCH = 1024;
+
+long lockstep_interval = 0;		// instructions between full memory hashes, 0 without --lockstep
+
+// Takes a hash and a cache event
+// Returns the hash with the event mixed in
+uint64_t hash_event(uint64_t hash, const CacheEvent &event) {
+	for (char c : event.cache + " " + event.status)
+		hash = hash_mix(hash, c);
+	return hash_mix(hash, ((uint64_t)event.pc << 40) | ((uint64_t)event.addr << 20) | (uint64_t)event.row);
+}
+
+// Takes the number of instructions run so far
+// Runs the next instruction and describes it in record
+// Returns false, without running anything, once everything has halted
+bool lockstep_step(long step, LockstepRecord &record) {
+	if (machine_halted)
+		return false;
+
+	record = LockstepRecord{};
+	record.step = step;
+	record.pc = simulated_pc();
+	record.instruction = memory[record.pc];
+	unsigned base = simulated_register((record.instruction >> 10) & 7);
+	unsigned pointer = (base + (record.instruction & 63) - (record.instruction & 64)) & 8191;
+
+	cache_events.clear();
+	simulate_instruction();
+	uint64_t events = HASH_START;
+	for (const CacheEvent &event : cache_events)
+		events = hash_event(events, event);
+
+	record.core = (cores.size() > 1) ? current_core : 0;
+	for (size_t i = 0; i < NUM_REGS; i++)
+		record.registers[i] = registers[i];
+	if (find_opcode(record.instruction) == op_sw)
+		record.stored = memory[pointer];
+	record.halted = machine_halted;
+	record.memory = memory_digest;
+	record.events = events;
+	if ((step + 1) % lockstep_interval == 0 || machine_halted)
+		record.checkpoint = hash_memory(memory);
+	return true;
+}
+
+// Takes the record of an instruction from each engine
+// Prints how they differ
+void print_divergence(const LockstepRecord &reference, const LockstepRecord &fast) {
+	cerr << "Lockstep divergence at instruction " << reference.step << ", core " << reference.core <<
+		", pc " << reference.pc << ", instruction " << bitset<16>(reference.instruction) << endl;
+	const LockstepRecord *records[] = {&reference, &fast};
+	const char *names[] = {"reference", "fast     "};
+	for (int side = 0; side < 2; side++) {
+		const LockstepRecord &r = *records[side];
+		cerr << "  " << names[side] << " core " << r.core << ", pc " << r.pc << ", registers";
+		for (size_t i = 0; i < NUM_REGS; i++)
+			cerr << " " << r.registers[i];
+		cerr << ", stored " << r.stored << ", halted " << r.halted << hex <<
+			", events " << r.events << ", memory " << r.memory << ", checkpoint " << r.checkpoint << dec << endl;
+	}
+}
+
+// Runs the program on the reference engine (execute_instruction, scalar tag probe
+// and block data) and, in a forked copy of this process, on the fast engine with the
+// chosen probe and --tag-only if given.
+// The copy sends a record of each instruction through a pipe, and the two are
+// compared one instruction at a time, including memory_digest, with all of memory[]
+// hashed again every lockstep_interval instructions.
+// Prints the first divergence or a summary
+// Returns false if the engines diverged
+bool run_lockstep() {
+	int fds[2];
+	if (pipe(fds) != 0) {
+		cerr << "Can't create the lockstep pipe" << endl;
+		return false;
+	}
+	cout.flush();
+	pid_t child = fork();
+	if (child < 0) {
+		cerr << "Can't fork the fast engine" << endl;
+		return false;
+	}
+
+	record_cache_events = true;
+	long step = 0;
+	LockstepRecord record{};
+	if (child == 0) {
+		// The fast engine: quiet, sending its records in batches
+		close(fds[0]);
+		if (freopen("/dev/null", "w", stdout) == nullptr)
+			_exit(1);
+		log_enabled = false;
+		fast_engine = true;
+		vector<LockstepRecord> batch;
+		batch.reserve(LOCKSTEP_BATCH);
+		while (lockstep_step(step++, record)) {
+			batch.push_back(record);
+			if (batch.size() == LOCKSTEP_BATCH || step % lockstep_interval == 0 || machine_halted) {
+				size_t bytes = batch.size() * sizeof(LockstepRecord);
+				if (write(fds[1], batch.data(), bytes) != (ssize_t)bytes)
+					_exit(1);
+				batch.clear();
+			}
+		}
+		close(fds[1]);
+		_exit(0);
 	}
 
-	else if (op_code == op_addi) {
-		regSrcA = (instruction >> 10) & 7;
-		regDst = (instruction >> 7) & 7;
-		imm = instruction & 127;
+	// The reference engine
+	close(fds[1]);
+	fast_engine = false;
+	tag_only = false;
+	tag_probe = probe_scalar;
+
+	FILE *pipe_in = fdopen(fds[0], "r");
+	LockstepRecord fast;
+	bool diverged = false;
+	long checkpoints = 0;
+	while (true) {
+		bool ran = lockstep_step(step, record);
+		bool fast_ran = fread(&fast, sizeof(fast), 1, pipe_in) == 1;
+		if (!ran && !fast_ran)
+			break;
+		if (ran != fast_ran || memcmp(&record, &fast, sizeof(record)) != 0) {
+			if (!ran)
+				record.step = step;
+			print_divergence(record, fast);
+			diverged = true;
+			break;
+		}
+		if (record.checkpoint != 0)
+			checkpoints++;
+		step++;
+	}
+	record_cache_events = false;
+	cache_events.clear();
+	fclose(pipe_in);
+	if (diverged)
+		kill(child, SIGKILL);
+	waitpid(child, nullptr, 0);
+
+	if (!diverged)
+		cout << "Lockstep instructions " << step << ", memory checkpoints " << checkpoints <<
+			", no divergence" << endl;
+	return !diverged;
+}
 
-		if (imm > 63)
-			imm = to_signed_binary(imm);
+/*
+	Result cache
+
+	With --result-cache, keeps the output of finished runs on disk, so that running the
+	same program under the same options again prints it at once instead of simulating.
+	Entries are keyed by a hash of the loaded memory image, the options that change the
+	output and the source of the simulator, hold the output compressed with zlib, and
+	are removed oldest first once the directory grows past its size limit. Runs that
+	print the log are only kept with --result-cache-log, since their output can be
+	large, and runs whose output depends on the host or writes files (--bench,
+	--threads, --lockstep, --profile, --reuse-profile) are never kept. A directory
+	that can't be written only means nothing is kept.
+*/
 
-		if (regDst != 0)
-			registers[regDst] = (registers[regSrcA] + imm) & 65535;
+// Identifies the simulator in result cache keys, so that changing its source retires
+// the results of the old one. The makefile passes a checksum of simcache.cpp and
+// simcache.h; a build without one never uses the result cache.
+#ifdef SIMCACHE_SOURCE
+uint64_t const static SIMCACHE_SOURCE_HASH = SIMCACHE_SOURCE;
+#else
+uint64_t const static SIMCACHE_SOURCE_HASH = 0;
+#endif
+
+// Stream buffer that passes what is written on to another one and keeps a copy
+struct TeeBuffer : streambuf {
+	streambuf *destination;
+	string copy;
+
+	TeeBuffer(streambuf *destination) : destination(destination) {}
+
+	int overflow(int c) override {
+		if (c == EOF)
+			return 0;
+		copy += (char)c;
+		return destination->sputc(c);
+	}
 
-		increment_pc();
-		return false;
+	streamsize xsputn(const char *s, streamsize n) override {
+		copy.append(s, n);
+		return destination->sputn(s, n);
 	}
 
-	else if (op_code == op_j) {
-		imm = instruction & 8191;	// isolate least significant 13 bits
+	int sync() override {
+		return destination->pubsync();
+	}
+};
+
+struct ResultCache {
+	bool enabled = false;		// set by --result-cache or --result-cache-dir
+	bool keep_logs = false;		// set by --result-cache-log
+	string directory;			// set by --result-cache-dir
+	uintmax_t max_bytes = 64 << 20;	// set by --result-cache-size
+	string configuration;		// options that change the output, set by setup_simulation
+	uint64_t key = 0;
+
+	// Returns the directory entries go in when --result-cache-dir isn't given, or ""
+	// if there is no home directory to put it in
+	static string default_directory() {
+		const char *xdg = getenv("XDG_CACHE_HOME");
+		if (xdg != nullptr && *xdg != 0)
+			return string(xdg) + "/simcache";
+		const char *home = getenv("HOME");
+		if (home != nullptr && *home != 0)
+			return string(home) + "/.cache/simcache";
+		return "";
+	}
 
-		if (pc == imm)	// if instruction is halt, do nothing to pc
-			return true;
-		else {
-			set_pc(imm);
-			return false;
-		}
+	// Returns whether the output of this run may be kept and replayed
+	bool usable() const {
+		return enabled && SIMCACHE_SOURCE_HASH != 0 && directory.size() > 0 && (keep_logs || !log_enabled) && !show_bench &&
+			num_threads == 0 && lockstep_interval == 0 && !reuse_profile.enabled && !execution_profile.enabled;
 	}
 
-	else if (op_code == op_jal) {
-		imm = instruction & 8191;
+	string path() const {
+		return directory + "/" + hash_text(key) + ".result";
+	}
 
-		registers[7] = pc + 1;
-		set_pc(imm);
-		return false;
+	// Hashes the source, the options and memory[] as loaded into key
+	// Returns whether an entry for it was found, after printing its output
+	bool replay() {
+		key = hash_mix(HASH_START, SIMCACHE_SOURCE_HASH);
+		for (char c : configuration)
+			key = hash_mix(key, c);
+		for (size_t addr = 0; addr < MEM_SIZE; addr++)
+			key = hash_mix(key, memory[addr]);
+
+		ifstream f(path(), ios::binary);
+		string magic, stored_key;
+		uLongf size = 0;
+		if (!(f >> magic >> stored_key >> size) || magic != "simcache-result" || stored_key != hash_text(key))
+			return false;
+		f.get();
+		string compressed((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+		string output(size, 0);
+		if (uncompress((Bytef *)&output[0], &size, (const Bytef *)compressed.data(), compressed.size()) != Z_OK ||
+				size != output.size())
+			return false;
+		cout.write(output.data(), output.size());
+
+		// Eviction removes the least recently used entries first
+		error_code ignored;
+		filesystem::last_write_time(path(), filesystem::file_time_type::clock::now(), ignored);
+		return true;
 	}
 
-	else {
-		cout << "invalid instruction at pc: " << pc << endl;
-		return false;
+	// Takes the output of the run found missing by replay
+	// Writes its entry, then evicts old entries until the directory fits the limit
+	void store(const string &output) {
+		uLongf size = compressBound(output.size());
+		string compressed(size, 0);
+		if (compress2((Bytef *)&compressed[0], &size, (const Bytef *)output.data(), output.size(), Z_BEST_SPEED) != Z_OK ||
+				size > max_bytes)
+			return;
+		compressed.resize(size);
+
+		// Written under a temporary name so that a concurrent run never reads half an entry
+		error_code error;
+		filesystem::create_directories(directory, error);
+		string temporary = path() + "." + to_string(getpid());
+		{
+			ofstream f(temporary, ios::binary);
+			if (!f.is_open())
+				return;
+			f << "simcache-result " << hash_text(key) << " " << output.size() << "\n" << compressed;
+			if (!f)
+				return;
+		}
+		filesystem::rename(temporary, path(), error);
+		if (error) {
+			filesystem::remove(temporary, error);
+			return;
+		}
+
+		struct Entry {
+			filesystem::file_time_type time;
+			uintmax_t bytes;
+			filesystem::path path;
+		};
+		vector<Entry> entries;
+		uintmax_t total = 0;
+		filesystem::directory_iterator file(directory, error), end;
+		for (; !error && file != end; file.increment(error)) {
+			if (file->path().extension() != ".result")
+				continue;
+			Entry entry{file->last_write_time(error), file->file_size(error), file->path()};
+			if (!error) {
+				entries.push_back(entry);
+				total += entry.bytes;
+			}
+		}
+		sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.time < b.time; });
+		for (size_t i = 0; i < entries.size() && total > max_bytes; i++) {
+			if (filesystem::remove(entries[i].path, error))
+				total -= entries[i].bytes;
+		}
 	}
-}
+};
 
-/**
-	Main function
-	Takes command-line args as documented below
-*/
-int main(int argc, char *argv[]) {
+ResultCache result_cache;
+
+// Takes the command-line arguments
+// Loads the program and builds the caches and cores they describe, printing the
+// cache configurations, or prints usage or an error
+// Returns 0 on success and 1 otherwise. Nothing is simulated unless there is a cache
+int setup_simulation(int argc, char *argv[]) {
 	/*
 		Parse the command-line arguments
 	*/
 	char *filename = nullptr;
 	bool do_help = false;
 	bool arg_error = false;
-	string cache_config;
+	vector<string> level_specs;		// one spec per cache level, top level first
+	vector<pair<string, string>> cache_options;	// per-cache options and their values
+	string timing_config;
+	int l2_mode = -1;	// -1 leaves the mode of each level spec alone
+	int num_cores = 1;
+	string entry_config;
+	bool predict_branches = false;
+	string tlb_config = "4,4,16,4";
+	string tlb_policies = "lru";
+	long page_table = -1;		// -1 keeps the table outside memory
+	choose_probe("auto");
 	for (int i=1; i<argc; i++) {
 		string arg(argv[i]);
 		if (arg.rfind("-",0)==0) {
@@ -647,8 +3610,266 @@ int main(int argc, char *argv[]) {
 				i++;
 				if (i>=argc)
 					arg_error = true;
+				else {
+					// Every three values describe one more level
+					vector<string> values = split_list(argv[i]);
+					if (values.size() % 3 != 0)
+						arg_error = true;
+					for (size_t j = 0; j + 2 < values.size(); j += 3)
+						level_specs.push_back(values[j] + "," + values[j + 1] + "," + values[j + 2]);
+				}
+			}
+			else if (arg=="--level") {
+				i++;
+				if (i>=argc)
+					arg_error = true;
+				else
+					level_specs.push_back(argv[i]);
+			}
+			else if (arg=="--cache-file") {
+				i++;
+				if (i>=argc)
+					arg_error = true;
+				else if (!read_cache_file(argv[i], level_specs)) {
+					cerr << "Can't open file "<< argv[i] << endl;
+					return 1;
+				}
+			}
+			else if (arg=="--write-policy" || arg=="--write-alloc" || arg=="--prefetch") {
+				i++;
+				if (i>=argc)
+					arg_error = true;
+				else
+					cache_options.push_back({arg, argv[i]});
+			}
+			else if (arg=="--l2-mode") {
+				i++;
+				if (i>=argc)
+					arg_error = true;
+				else if (string(argv[i]) == "nine")
+					l2_mode = MODE_NINE;
+				else if (string(argv[i]) == "inclusive")
+					l2_mode = MODE_INCLUSIVE;
+				else if (string(argv[i]) == "exclusive")
+					l2_mode = MODE_EXCLUSIVE;
+				else
+					arg_error = true;
+			}
+			else if (arg=="--cores") {
+				i++;
+				if (i>=argc || stoi(argv[i]) < 1)
+					arg_error = true;
+				else
+					num_cores = stoi(argv[i]);
+			}
+			else if (arg=="--entry") {
+				i++;
+				if (i>=argc)
+					arg_error = true;
+				else
+					entry_config = argv[i];
+			}
+			else if (arg=="--threads" || arg=="--quantum") {
+				i++;
+				if (i>=argc || stoi(argv[i]) < 1)
+					arg_error = true;
+				else if (arg=="--threads")
+					num_threads = stoi(argv[i]);
+				else
+					quantum = stoi(argv[i]);
+			}
+			else if (arg=="--quiet")
+				log_enabled = false;
+			else if (arg=="--reuse-profile") {
+				i++;
+				if (i>=argc)
+					arg_error = true;
+				else
+					reuse_profile.filename = argv[i];
+			}
+			else if (arg=="--reuse-block" || arg=="--reuse-window") {
+				i++;
+				if (i>=argc || stoi(argv[i]) < 1)
+					arg_error = true;
+				else if (arg=="--reuse-block")
+					reuse_profile.blocksize = stoi(argv[i]);
+				else
+					reuse_profile.window = stoi(argv[i]);
+			}
+			else if (arg=="--classify")
+				classify_misses = true;
+			else if (arg=="--tag-only")
+				tag_only = true;
+			else if (arg=="--probe") {
+				i++;
+				if (i>=argc || !choose_probe(argv[i]))
+					arg_error = true;
+			}
+			else if (arg=="--coherence") {
+				i++;
+				if (i>=argc)
+					arg_error = true;
+				else if (string(argv[i]) == "msi")
+					coherence = COHERENCE_MSI;
+				else if (string(argv[i]) == "mesi")
+					coherence = COHERENCE_MESI;
+				else
+					arg_error = true;
+			}
+			else if (arg=="--victim") {
+				i++;
+				if (i>=argc || stoi(argv[i]) < 1)
+					arg_error = true;
+				else
+					victim_cache.assign(stoi(argv[i]), VictimEntry());
+			}
+			else if (arg=="--prefetch-degree") {
+				i++;
+				if (i>=argc || stoi(argv[i]) < 1)
+					arg_error = true;
+				else
+					prefetch_degree = stoi(argv[i]);
+			}
+			else if (arg=="--stats")
+				show_stats = true;
+			else if (arg=="--bench")
+				show_bench = true;
+			else if (arg=="--profile") {
+				i++;
+				if (i>=argc)
+					arg_error = true;
+				else
+					execution_profile.filename = argv[i];
+			}
+			else if (arg=="--predictor") {
+				i++;
+				predict_branches = true;
+				if (i>=argc)
+					arg_error = true;
+				else if (string(argv[i]) == "static")
+					branch_predictor.kind = BP_STATIC;
+				else if (string(argv[i]) == "bimodal")
+					branch_predictor.kind = BP_BIMODAL;
+				else if (string(argv[i]) == "gshare")
+					branch_predictor.kind = BP_GSHARE;
+				else
+					arg_error = true;
+			}
+			else if (arg=="--predictor-entries" || arg=="--btb" || arg=="--ras") {
+				i++;
+				predict_branches = true;
+				int n = (i < argc) ? stoi(argv[i]) : 0;
+				// The tables are indexed by the low bits of the pc
+				if (n < 1 || (arg != "--ras" && (n & (n - 1)) != 0))
+					arg_error = true;
+				else if (arg=="--predictor-entries")
+					branch_predictor.entries = n;
+				else if (arg=="--btb")
+					branch_predictor.btb_entries = n;
+				else
+					branch_predictor.ras_entries = n;
+			}
+			else if (arg=="--pipeline")
+				pipeline.enabled = true;
+			else if (arg=="--host-pipeline")
+				use_host_pipeline = true;
+			else if (arg=="--paging") {
+				i++;
+				int words = (i < argc) ? stoi(argv[i]) : 0;
+				if (words < 1 || (words & (words - 1)) != 0 || words > (int)MEM_SIZE / 2)
+					arg_error = true;
+				else {
+					paging.enabled = true;
+					paging.page_words = words;
+				}
+			}
+			else if (arg=="--page-table") {
+				i++;
+				if (i>=argc || stoi(argv[i]) < 0)
+					arg_error = true;
+				else
+					page_table = stoi(argv[i]);
+			}
+			else if (arg=="--tlb" || arg=="--tlb-policy") {
+				i++;
+				if (i>=argc)
+					arg_error = true;
+				else if (arg=="--tlb")
+					tlb_config = argv[i];
+				else
+					tlb_policies = argv[i];
+			}
+			else if (arg=="--final-hash")
+				show_final_hash = true;
+			else if (arg=="--expect-hash") {
+				i++;
+				if (i>=argc)
+					arg_error = true;
+				else {
+					check_final_hash = true;
+					expected_hash = stoull(argv[i], nullptr, 16);
+				}
+			}
+			else if (arg=="--dump-state") {
+				i++;
+				if (i>=argc || stoi(argv[i]) < 1)
+					arg_error = true;
+				else
+					dump_words = min<size_t>(stoi(argv[i]), MEM_SIZE);
+			}
+			else if (arg=="--engine") {
+				i++;
+				if (i>=argc)
+					arg_error = true;
+				else if (string(argv[i]) == "fast")
+					fast_engine = true;
+				else if (string(argv[i]) != "reference")
+					arg_error = true;
+			}
+			else if (arg=="--lockstep") {
+				i++;
+				if (i>=argc || stoi(argv[i]) < 1)
+					arg_error = true;
+				else
+					lockstep_interval = stoi(argv[i]);
+			}
+			else if (arg=="--timing") {
+				i++;
+				if (i>=argc)
+					arg_error = true;
+				else
+					timing_config = argv[i];
+			}
+			else if (arg=="--result-cache")
+				result_cache.enabled = true;
+			else if (arg=="--no-result-cache")
+				result_cache.enabled = false;
+			else if (arg=="--result-cache-log")
+				result_cache.keep_logs = true;
+			else if (arg=="--result-cache-dir") {
+				i++;
+				if (i>=argc)
+					arg_error = true;
+				else {
+					result_cache.enabled = true;
+					result_cache.directory = argv[i];
+				}
+			}
+			else if (arg=="--result-cache-size") {
+				i++;
+				if (i>=argc || stoi(argv[i]) < 1)
+					arg_error = true;
+				else
+					result_cache.max_bytes = (uintmax_t)stoi(argv[i]) << 20;
+			}
+			else if (arg=="--dram-bw" || arg=="--mshr") {
+				i++;
+				if (i>=argc || stoi(argv[i]) < 1)
+					arg_error = true;
+				else if (arg=="--dram-bw")
+					timing.dram_cycles_per_word = stoi(argv[i]);
 				else
-					cache_config = argv[i];
+					timing.mshr_free_at.assign(stoi(argv[i]), 0);
 			}
 			else
 				arg_error = true;
@@ -662,7 +3883,22 @@ int main(int argc, char *argv[]) {
 
 	/* Display error message if appropriate */
 	if (arg_error || do_help || filename == nullptr) {
-		cerr << "usage " << argv[0] << " [-h] [--cache CACHE] filename" << endl << endl; 
+		cerr << "usage " << argv[0] << " [-h] [--cache CACHE] [--level LEVEL]" << endl;
+		cerr << "       [--cache-file FILE] [--write-policy POLICY]" << endl;
+		cerr << "       [--write-alloc ALLOC] [--stats] [--bench] [--timing LATENCIES]" << endl;
+		cerr << "       [--dram-bw CYCLES] [--mshr N] [--prefetch KIND]" << endl;
+		cerr << "       [--prefetch-degree N] [--l2-mode MODE] [--victim N]" << endl;
+		cerr << "       [--cores N] [--entry PCS] [--coherence PROTOCOL]" << endl;
+		cerr << "       [--threads N] [--quantum N] [--quiet] [--probe KIND]" << endl;
+		cerr << "       [--classify] [--reuse-profile FILE]" << endl;
+		cerr << "       [--reuse-block N] [--reuse-window N] [--engine ENGINE]" << endl;
+		cerr << "       [--lockstep N] [--final-hash] [--expect-hash HASH]" << endl;
+		cerr << "       [--dump-state N] [--profile FILE] [--predictor KIND]" << endl;
+		cerr << "       [--predictor-entries N] [--btb N] [--ras N] [--pipeline]" << endl;
+		cerr << "       [--result-cache] [--result-cache-dir DIR] [--result-cache-size MB]" << endl;
+		cerr << "       [--result-cache-log] [--host-pipeline] [--paging WORDS]" << endl;
+		cerr << "       [--page-table ADDR] [--tlb TLBS] [--tlb-policy POLICY] [--tag-only]" << endl;
+		cerr << "       filename" << endl << endl;
 		cerr << "Simulate E20 cache" << endl << endl;
 		cerr << "positional arguments:" << endl;
 		cerr << "  filename    The file containing machine code, typically with .bin suffix" << endl<<endl;
@@ -671,10 +3907,122 @@ int main(int argc, char *argv[]) {
 		cerr << "  --cache CACHE  Cache configuration: size,associativity,blocksize (for one"<<endl;
 		cerr << "                 cache) or"<<endl;
 		cerr << "                 size,associativity,blocksize,size,associativity,blocksize"<<endl;
-		cerr << "                 (for two caches)"<<endl;
+		cerr << "                 (for two caches), and so on for more levels"<<endl;
+		cerr << "  --level LEVEL  Add a cache level below those given so far:"<<endl;
+		cerr << "                 size,associativity,blocksize followed by any of wt, wb,"<<endl;
+		cerr << "                 alloc, noalloc, nine, inclusive, exclusive and a prefetcher"<<endl;
+		cerr << "  --cache-file FILE  Add the levels in FILE, one LEVEL per line"<<endl;
+		cerr << "  --write-policy POLICY  wt (write-through, default) or wb (write-back),"<<endl;
+		cerr << "                 one per cache separated by commas, or one for all caches"<<endl;
+		cerr << "  --write-alloc ALLOC  alloc (write-allocate, default) or noalloc"<<endl;
+		cerr << "                 (no-write-allocate), per cache like --write-policy"<<endl;
+		cerr << "  --stats     print hit, miss, writeback and memory traffic counts at exit"<<endl;
+		cerr << "  --bench     print the words loaded, instructions and memory accesses run,"<<endl;
+		cerr << "                 and the seconds spent loading and running"<<endl;
+		cerr << "  --timing LATENCIES  Enable the cycle model: hit latency of each cache"<<endl;
+		cerr << "                 followed by DRAM latency, e.g. 1,10,100 for two caches"<<endl;
+		cerr << "  --dram-bw CYCLES  DRAM cycles per word transferred (default 1)"<<endl;
+		cerr << "  --mshr N    number of MSHRs for outstanding misses (default 4)"<<endl;
+		cerr << "  --prefetch KIND  none (default), nextline, stride or stream,"<<endl;
+		cerr << "                 per cache like --write-policy"<<endl;
+		cerr << "  --prefetch-degree N  blocks prefetched ahead per trigger (default 1)"<<endl;
+		cerr << "  --l2-mode MODE  nine (default), inclusive or exclusive: whether L2 holds"<<endl;
+		cerr << "                 every block of L1, no block of L1, or either. Lower levels"<<endl;
+		cerr << "                 take their mode from their LEVEL spec"<<endl;
+		cerr << "  --victim N  add a fully-associative victim cache of N L1 blocks behind L1"<<endl;
+		cerr << "  --cores N   simulate N cores with private L1s sharing the lower levels,"<<endl;
+		cerr << "                 interleaved round-robin one instruction at a time"<<endl;
+		cerr << "  --entry PCS  starting pc of each core, separated by commas (default 0)"<<endl;
+		cerr << "  --coherence PROTOCOL  mesi (default) or msi, between the private L1s"<<endl;
+		cerr << "  --threads N  run the cores on N host threads, synchronizing every quantum"<<endl;
+		cerr << "                 (results depend on the quantum but not on N)"<<endl;
+		cerr << "  --quantum N  instructions each core runs between barriers (default 1000)"<<endl;
+		cerr << "  --quiet     don't print the log entries"<<endl;
+		cerr << "  --probe KIND  auto (default), scalar, sse2 or avx2: how tag lookups compare"<<endl;
+		cerr << "                 the ways of a row. auto picks the widest the CPU supports"<<endl;
+		cerr << "  --classify  label each MISS compulsory, capacity or conflict using a"<<endl;
+		cerr << "                 fully-associative LRU shadow of each cache, and print"<<endl;
+		cerr << "                 the totals per cache and per pc at exit"<<endl;
+		cerr << "  --reuse-profile FILE  write reuse distances, working-set sizes and per-pc"<<endl;
+		cerr << "                 strides of the loads and stores to FILE, as JSON if it ends"<<endl;
+		cerr << "                 in .json and as CSV otherwise"<<endl;
+		cerr << "  --reuse-block N  block size in words for --reuse-profile (default 1)"<<endl;
+		cerr << "  --reuse-window N  accesses in a working-set window (default 1024)"<<endl;
+		cerr << "  --engine ENGINE  reference (default) or fast: run each instruction as"<<endl;
+		cerr << "                 it is fetched, or decode it once and reuse the decoding"<<endl;
+		cerr << "  --lockstep N  run the reference engine with the scalar probe and block"<<endl;
+		cerr << "                 data against the fast engine with the chosen ones (such as"<<endl;
+		cerr << "                 --tag-only), comparing registers, cache events and the memory"<<endl;
+		cerr << "                 hash every instruction and all of memory every N, and report"<<endl;
+		cerr << "                 the first divergence"<<endl;
+		cerr << "  --final-hash  print a hash of the final memory, pcs and registers"<<endl;
+		cerr << "  --expect-hash HASH  exit with 1 and dump the whole final state if the"<<endl;
+		cerr << "                 final hash isn't HASH"<<endl;
+		cerr << "  --dump-state N  print the final pcs, registers and first N words of memory"<<endl;
+		cerr << "  --profile FILE  write each pc's executions, jeq outcomes and L1 misses"<<endl;
+		cerr << "                 next to its source (from asm -g) to FILE, and the"<<endl;
+		cerr << "                 instructions run in each jal/jr call stack to FILE.folded"<<endl;
+		cerr << "  --predictor KIND  static (backward taken), bimodal (default) or gshare:"<<endl;
+		cerr << "                 predict each jeq and print the mispredictions in total"<<endl;
+		cerr << "                 and per pc at exit"<<endl;
+		cerr << "  --predictor-entries N  2-bit counters of the predictor, a power of two"<<endl;
+		cerr << "                 (default 1024)"<<endl;
+		cerr << "  --btb N     predict the targets of taken jumps with an N-entry BTB, a"<<endl;
+		cerr << "                 power of two (default none: targets known at decode)"<<endl;
+		cerr << "  --ras N     predict jr with an N-entry return-address stack"<<endl;
+		cerr << "  --pipeline  add a 5-stage in-order pipeline to the cycle model of --timing:"<<endl;
+		cerr << "                 load-use and branch stalls, with the CPI and the stall"<<endl;
+		cerr << "                 cycles per cause and per pc at exit"<<endl;
+		cerr << "  --result-cache  replay the output of an earlier run of the same program"<<endl;
+		cerr << "                 and options instead of simulating, and keep the output of"<<endl;
+		cerr << "                 this one, in $XDG_CACHE_HOME/simcache or ~/.cache/simcache."<<endl;
+		cerr << "                 --bench, --threads, --lockstep and the profiles always"<<endl;
+		cerr << "                 simulate. --no-result-cache turns it off again"<<endl;
+		cerr << "  --result-cache-dir DIR  --result-cache, keeping the outputs in DIR"<<endl;
+		cerr << "  --result-cache-size MB  remove the least recently used outputs once DIR"<<endl;
+		cerr << "                 holds more than MB megabytes (default 64)"<<endl;
+		cerr << "  --result-cache-log  keep the output of runs that print the log too,"<<endl;
+		cerr << "                 not only of --quiet ones"<<endl;
+		cerr << "  --host-pipeline  run the cache model and the log on host threads of their"<<endl;
+		cerr << "                 own, fed by the interpreter through ring buffers. A single"<<endl;
+		cerr << "                 core only, without --timing, --profile, --lockstep or --paging."<<endl;
+		cerr << "                 Only for hosts with free cores: on one CPU the threads take"<<endl;
+		cerr << "                 turns and the run is slightly slower"<<endl;
+		cerr << "  --paging WORDS  translate the addresses of loads and stores through pages"<<endl;
+		cerr << "                 of WORDS words, a power of two, with TLBs in front of L1, and"<<endl;
+		cerr << "                 print TLB and page walk counts in total and per pc at exit."<<endl;
+		cerr << "                 Every page maps to itself unless --page-table is given"<<endl;
+		cerr << "  --page-table ADDR  walk a page table in memory at ADDR, past the loaded"<<endl;
+		cerr << "                 program: a word per page, which the program stores, holding"<<endl;
+		cerr << "                 32768 (valid) plus the physical page. An invalid entry is a"<<endl;
+		cerr << "                 page fault, which maps the page to itself"<<endl;
+		cerr << "  --tlb TLBS  entries,associativity of each TLB level, first level first"<<endl;
+		cerr << "                 (default 4,4,16,4)"<<endl;
+		cerr << "  --tlb-policy POLICY  lru (default), fifo or random, per TLB like"<<endl;
+		cerr << "                 --write-policy"<<endl;
+		cerr << "  --tag-only  keep only the tags of the cached blocks, not copies of their"<<endl;
+		cerr << "                 data, and serve loads from memory, which always holds the"<<endl;
+		cerr << "                 latest values"<<endl;
 		return 1;
 	}
 
+	// Options that change the output, for the result cache key. Cache files count by
+	// the levels they hold rather than their names.
+	for (int i = 1; i < argc; i++) {
+		string arg(argv[i]);
+		if (argv[i] == filename || arg == "--result-cache" || arg == "--no-result-cache" ||
+				arg == "--result-cache-log")
+			continue;
+		if (arg == "--result-cache-dir" || arg == "--result-cache-size" || arg == "--cache-file")
+			i++;
+		else
+			result_cache.configuration += arg + " ";
+	}
+	for (const string &spec : level_specs)
+		result_cache.configuration += spec + ";";
+	if (result_cache.directory.size() == 0)
+		result_cache.directory = ResultCache::default_directory();
+
 	// Open file
 	ifstream f(filename);
 	if (!f.is_open()) {
@@ -683,97 +4031,344 @@ int main(int argc, char *argv[]) {
 	}
 
 	// Load f and parse using load_machine_code
-	load_machine_code(f, memory);
+	auto load_start = chrono::steady_clock::now();
+	loaded_words = load_machine_code(f, memory,
+		(execution_profile.filename.size() > 0) ? &execution_profile.source : nullptr);
+	memory_digest = hash_memory(memory);
+	load_seconds = chrono::duration<double>(chrono::steady_clock::now() - load_start).count();
 
 	/* parse cache config */
-	if (cache_config.size() > 0) {
-		vector<int> parts;
-		size_t pos;
-		size_t lastpos = 0;
-		while ((pos = cache_config.find(",", lastpos)) != string::npos) {
-			parts.push_back(stoi(cache_config.substr(lastpos,pos)));
-			lastpos = pos + 1;
-		}
-		parts.push_back(stoi(cache_config.substr(lastpos)));
-		if (parts.size() == 3) {
-			int L1size = parts[0];
-			int L1assoc = parts[1];
-			int L1blocksize = parts[2];
-			int L1rows = L1size / (L1assoc * L1blocksize);
-
-			// Create our cache as global 2D vector with columns "Row", "V", and "Tag"
-			// Need a "Row" column for n-way set-associative caches
-			for (int i = 0; i < L1rows; i++) {
-				for (size_t j = 0; j < L1assoc; j++) {
-					vector<int> row = {i, 0, 0, 0};
-					L1cache.push_back(row);
-					
-					vector<int> blockdata;
-					L1blockdata.push_back(blockdata);
-				}
-
-				deque<int> rowMRU;
-				L1MRU.push_back(rowMRU);
+	if (level_specs.size() > 0) {
+		for (const string &spec : level_specs) {
+			if (!add_cache_level(spec)) {
+				cerr << "Invalid cache config"  << endl;
+				return 1;
 			}
+		}
+		int num_caches = levels.size();
+		if (classify_misses) {
+			for (CacheLevel &cache : levels)
+				cache.shadow = ShadowCache(cache.blocksize, cache.rows * cache.assoc);
+		}
 
-			print_cache_config("L1", L1size, L1assoc, L1blocksize, L1rows);
+		// Apply the per-cache options, one value per cache or a single value for all of them
+		for (auto &option : cache_options) {
+			if (!set_cache_options(option.first, option.second)) {
+				cerr << "Invalid " << option.first << " value" << endl;
+				return 1;
+			}
+		}
 
-			// TODO: execute E20 program and simulate one cache here
-			bool halt = false;
-			while (!halt) {
-				halt = execute_instruction(memory[pc], L1blocksize, L1assoc);
+		// L1 has no level above it. An exclusive level swaps whole blocks with the level
+		// above, and an inclusive level's blocks must cover the blocks above.
+		levels[0].mode = MODE_NINE;
+		if (l2_mode != -1 && num_caches > 1)
+			levels[1].mode = l2_mode;
+		for (size_t level = 1; level < levels.size(); level++) {
+			CacheLevel &cache = levels[level];
+			if ((cache.mode == MODE_EXCLUSIVE && cache.blocksize != levels[level - 1].blocksize) ||
+				(cache.mode == MODE_INCLUSIVE && cache.blocksize < levels[level - 1].blocksize)) {
+				cerr << "Invalid blocksizes for the inclusion mode of " << cache.name << endl;
+				return 1;
 			}
-		} else if (parts.size() == 6) {
-			int L1size = parts[0];
-			int L1assoc = parts[1];
-			int L1blocksize = parts[2];
-			int L2size = parts[3];
-			int L2assoc = parts[4];
-			int L2blocksize = parts[5];
-			int L1rows = L1size / (L1assoc * L1blocksize);
-			int L2rows = L2size / (L2assoc * L2blocksize);
+		}
 
-			// Initialize our cache as 2D array with columns "Row" "V", and "Tag"
-			for (int i = 0; i < L1rows; i++) {
-				for (size_t j = 0; j < L1assoc; j++) {
-					vector<int> row = {i, 0, 0};
-					L1cache.push_back(row);
+		// Parse the latencies of the cycle model, one per cache plus DRAM
+		if (timing_config.size() > 0) {
+			for (const string &value : split_list(timing_config))
+				timing.latency.push_back(stoi(value));
+			if (timing.latency.size() != num_caches + 1 || timing.latency[0] < 1) {
+				cerr << "Invalid timing config" << endl;
+				return 1;
+			}
+			timing.enabled = true;
+			timing.level_stalls.assign(num_caches + 1, 0);
+		}
+		if (pipeline.enabled && !timing.enabled) {
+			cerr << "--pipeline needs the cycle model of --timing" << endl;
+			return 1;
+		}
+		// The interpreter runs ahead of the cache model, so nothing it does may depend on
+		// the caches
+		if (use_host_pipeline && (num_cores > 1 || timing.enabled || execution_profile.enabled ||
+				lockstep_interval > 0 || paging.enabled)) {
+			cerr << "--host-pipeline can't be combined with --cores, --timing, --profile, --lockstep or --paging" << endl;
+			return 1;
+		}
 
-					vector<int> blockdata;
-					L1blockdata.push_back(blockdata);
+		// The TLBs, two values per level, and the page table, which has to fit in memory
+		if (paging.enabled) {
+			vector<string> values = split_list(tlb_config);
+			vector<string> policies = split_list(tlb_policies);
+			for (size_t j = 0; j + 1 < values.size(); j += 2) {
+				int entries = stoi(values[j]);
+				int assoc = stoi(values[j + 1]);
+				if (entries < 1 || assoc < 1 || entries % assoc != 0)
+					break;
+				paging.tlbs.emplace_back("L" + to_string(j / 2 + 1) + " TLB", entries, assoc);
+			}
+			bool policies_valid = policies.size() == 1 || policies.size() == paging.tlbs.size();
+			for (size_t level = 0; policies_valid && level < paging.tlbs.size(); level++) {
+				const string &policy = policies[policies.size() == 1 ? 0 : level];
+				if (policy == "lru")
+					paging.tlbs[level].policy = TLB_LRU;
+				else if (policy == "fifo")
+					paging.tlbs[level].policy = TLB_FIFO;
+				else if (policy == "random")
+					paging.tlbs[level].policy = TLB_RANDOM;
+				else
+					policies_valid = false;
+			}
+			if (values.size() % 2 != 0 || paging.tlbs.size() != values.size() / 2 || !policies_valid) {
+				cerr << "Invalid paging config" << endl;
+				return 1;
+			}
+			// The program would read its own code and data as entries, and its stores to
+			// them would remap its pages
+			if (page_table != -1) {
+				paging.in_memory = true;
+				paging.table_base = page_table;
+				if (paging.table_base < loaded_words || paging.table_base + paging.pages() > MEM_SIZE) {
+					cerr << "Page table at " << page_table << " overlaps the program or runs past memory" << endl;
+					return 1;
 				}
+			}
+			if (num_cores > 1) {
+				cerr << "--paging can't be combined with --cores" << endl;
+				return 1;
+			}
+			paging.start();
+		}
+
+		for (const CacheLevel &cache : levels)
+			print_cache_config(cache.name, cache.size, cache.assoc, cache.blocksize, cache.rows);
+		if (reuse_profile.filename.size() > 0)
+			reuse_profile.start();
+		if (execution_profile.filename.size() > 0)
+			execution_profile.start(max(num_cores, 1));
+		if (predict_branches)
+			branch_predictor.start(max(num_cores, 1));
+		if (pipeline.enabled) {
+			pipeline.start(max(num_cores, 1));
+			timing.cycles += pipeline.fill;
+		}
+		observe_instructions = execution_profile.enabled || branch_predictor.enabled || pipeline.enabled;
+
+		// Give every core a private copy of L1 and the victim cache, and load core 0
+		if (num_cores > 1) {
+			vector<string> entries = split_list(entry_config);
+			if (entry_config.size() > 0 && entries.size() != num_cores) {
+				cerr << "Invalid entry points" << endl;
+				return 1;
+			}
+			if (num_threads > 0 && timing.enabled) {
+				cerr << "The cycle model can't be combined with --threads" << endl;
+				return 1;
+			}
+			if (num_threads > 0 && reuse_profile.filename.size() > 0) {
+				cerr << "--reuse-profile can't be combined with --threads" << endl;
+				return 1;
+			}
+			if (num_threads > 0 && execution_profile.filename.size() > 0) {
+				cerr << "--profile can't be combined with --threads" << endl;
+				return 1;
+			}
+			if (num_threads > 0 && predict_branches) {
+				cerr << "The branch predictor can't be combined with --threads" << endl;
+				return 1;
+			}
+			if (num_threads > 0 && lockstep_interval > 0) {
+				cerr << "--lockstep can't be combined with --threads" << endl;
+				return 1;
+			}
+			if (num_caches > 1 && levels[1].mode == MODE_EXCLUSIVE) {
+				cerr << "An exclusive L2 can't be shared by multiple cores" << endl;
+				return 1;
+			}
 
-				deque<int> rowMRU;
-				L1MRU.push_back(rowMRU);
+			cores.resize(num_cores);
+			for (int id = 0; id < num_cores; id++) {
+				cores[id].pc = (entry_config.size() > 0) ? stoi(entries[id]) % MEM_SIZE : 0;
+				cores[id].L1 = levels[0];
+				cores[id].L1.name = "L1." + to_string(id);
+				cores[id].victim_cache = victim_cache;
 			}
-			for (int i = 0; i < L2rows; i++) {
-				for (size_t j = 0; j < L2assoc; j++) {
-					vector<int> row = {i, 0, 0};
-					L2cache.push_back(row);
+			current_core = 0;
+			pc = cores[0].pc;
+			swap(levels[0], cores[0].L1);
+			swap(victim_cache, cores[0].victim_cache);
+		}
 
-					vector<int> blockdata;
-					L2blockdata.push_back(blockdata);
-				}
+	}
+	return 0;
+}
 
-				deque<int> rowMRU;
-				L2MRU.push_back(rowMRU);
+// Prints the statistics asked for on the command line and writes the reuse profile
+// Returns 1 if the profile can't be written, otherwise 0
+int finish_simulation() {
+	if (levels.size() > 0) {
+		if (show_stats) {
+			for (CacheLevel *cache : cache_list())
+				print_cache_stats(*cache);
+			if (victim_cache.size() > 0)
+				cout << "Victim cache entries " << victim_cache.size() << ", hits " << victim_hits <<
+					", misses " << victim_misses << endl;
+			for (const CacheLevel &cache : levels) {
+				if (cache.mode == MODE_INCLUSIVE) {
+					cout << "Back-invalidations " << back_invalidations << endl;
+					break;
+				}
+			}
+			cout << "Memory words read " << mem_words_read << ", words written " << mem_words_written << endl;
+			if (num_threads > 0)
+				cout << fixed << setprecision(3) << "Threads " << num_threads << ", quantum " << quantum <<
+					", quanta " << quanta << ", wall time " << parallel_seconds << " s" << endl;
+		}
+		for (CacheLevel *cache : cache_list()) {
+			if (cache->prefetcher != PF_NONE)
+				print_prefetch_stats(*cache);
+		}
+		if (classify_misses) {
+			for (CacheLevel *cache : cache_list())
+				print_miss_classes(*cache);
+		}
+		if (branch_predictor.enabled)
+			branch_predictor.print_stats();
+		if (cores.size() > 1)
+			print_core_stats();
+		if (timing.enabled)
+			print_timing_stats();
+		if (pipeline.enabled)
+			pipeline.print_stats(timing.cycles, timing.instructions);
+		if (paging.enabled)
+			paging.print_stats();
+
+		if (show_bench) {
+			// Every load and store goes through the L1 of the core that ran it
+			long accesses = 0;
+			for (size_t id = 0; id < max<size_t>(cores.size(), 1); id++) {
+				const CacheLevel &L1 = cores.empty() ? levels[0] : core_L1(id);
+				accesses += L1.read_hits + L1.read_misses + L1.write_hits + L1.write_misses;
 			}
+			cout << scientific << setprecision(3) << "Bench load words " << loaded_words <<
+				", seconds " << load_seconds << ", run instructions " << timing.instructions <<
+				", accesses " << accesses << ", seconds " << run_seconds << endl;
+		}
 
-			print_cache_config("L1", L1size, L1assoc, L1blocksize, L1rows);
-			print_cache_config("L2", L2size, L2assoc, L2blocksize, L2rows);
+		if (reuse_profile.enabled) {
+			const string &name = reuse_profile.filename;
+			ofstream out(name);
+			if (!out.is_open()) {
+				cerr << "Can't open file " << name << endl;
+				return 1;
+			}
+			if (name.size() >= 5 && name.compare(name.size() - 5, 5, ".json") == 0)
+				reuse_profile.write_json(out);
+			else
+				reuse_profile.write_csv(out);
+		}
 
-			// TODO: execute E20 program and simulate two caches here
-			bool halt = false;
-			while (!halt) {
-				halt = execute_instruction(memory[pc], L1blocksize, L1assoc, L2blocksize, L2assoc);
+		if (execution_profile.enabled) {
+			const string &name = execution_profile.filename;
+			ofstream listing(name);
+			ofstream stacks(name + ".folded");
+			if (!listing.is_open() || !stacks.is_open()) {
+				cerr << "Can't open file " << name << endl;
+				return 1;
 			}
-		} else {
-			cerr << "Invalid cache config"  << endl;
-			return 1;
+			vector<long> ran;
+			for (size_t id = 0; id < execution_profile.frame.size(); id++)
+				ran.push_back((cores.size() <= 1) ? timing.instructions : cores[id].instructions);
+			execution_profile.finish(ran);
+			execution_profile.write_listing(listing);
+			execution_profile.write_stacks(stacks);
 		}
 	}
 
 	// Print the final state of the simulator before ending, using print_state
-	// print_state(pc, registers, memory, 128);
+	if (dump_words > 0)
+		print_final_state(dump_words);
+	// Regression runs compare a hash of the final state, and only dump it all when
+	// the hash differs
+	if (show_final_hash || check_final_hash) {
+		uint64_t hash = final_state_hash();
+		if (show_final_hash)
+			cout << "Final hash " << hash_text(hash) << endl;
+		if (check_final_hash && hash != expected_hash) {
+			cerr << "Final hash " << hash_text(hash) << " doesn't match the expected " <<
+				hash_text(expected_hash) << endl;
+			print_final_state(MEM_SIZE);
+			return 1;
+		}
+	}
 	return 0;
 }
+
+// State of the simulation for the library interface in simcache.h
+
+bool simulation_ready() {
+	return levels.size() > 0;
+}
+
+bool simulation_halted() {
+	return machine_halted;
+}
+
+// Returns the core whose turn it is, or 0 with a single core
+size_t next_running_core() {
+	size_t id = next_core;
+	while (!machine_halted && cores.size() > 1 && cores[id].halted)
+		id = (id + 1) % cores.size();
+	return id;
+}
+
+unsigned simulated_pc() {
+	size_t id = next_running_core();
+	return (cores.size() <= 1 || id == current_core) ? pc : cores[id].pc;
+}
+
+unsigned simulated_register(int reg) {
+	size_t id = next_running_core();
+	return (cores.size() <= 1 || id == current_core) ? registers[reg & 7] : cores[id].registers[reg & 7];
+}
+
+unsigned simulated_memory(unsigned addr) {
+	return memory[addr % MEM_SIZE];
+}
+
+long simulated_instructions() {
+	return timing.instructions;
+}
+
+#ifndef SIMCACHE_LIBRARY
+/**
+	Main function
+	Takes command-line args as documented below
+*/
+int main(int argc, char *argv[]) {
+	if (setup_simulation(argc, argv) != 0)
+		return 1;
+	if (levels.size() == 0)
+		return 0;
+
+	// A run seen before prints its output from the result cache; otherwise the
+	// output is captured for it
+	bool cached = result_cache.usable();
+	if (cached && result_cache.replay())
+		return 0;
+	TeeBuffer output(cout.rdbuf());
+	if (cached)
+		cout.rdbuf(&output);
+
+	if (lockstep_interval > 0) {
+		if (!run_lockstep())
+			return 1;
+	} else
+		run_simulation();
+	int status = finish_simulation();
+	cout.rdbuf(output.destination);
+	if (cached && status == 0)
+		result_cache.store(output.copy);
+	return status;
+}
+#endif
@@ -0,0 +1,177 @@
+/*
+simcache.h
+
+Library interface of the E20 cache simulator. Build simcache.cpp with
+-DSIMCACHE_LIBRARY (make libsimcache.a) to leave out its main() and link it
+into another program that includes this header.
+*/
+
+#ifndef SIMCACHE_H
+#define SIMCACHE_H
+
+#include <string>
+#include <vector>
+#include <type_traits>
+
+// One cache event: the fields of a log entry, recorded for observers whether or not
+// the log is printed
+struct CacheEvent {
+	std::string cache;		// "L1", "L2", "L1.0", "VC", ...
+	const char *status;		// "HIT", "MISS", "SW", "WB", "PF" or "INV"
+	int pc;
+	int addr;
+	int row;
+};
+
+// While record_cache_events is set, every cache event is appended to cache_events.
+// Simulator sets it for an observer and hands the events of each instruction to that
+// observer once the instruction has run.
+extern bool record_cache_events;
+extern std::vector<CacheEvent> cache_events;
+
+int setup_simulation(int argc, char *argv[]);
+bool simulate_instruction();
+void run_simulation();
+int finish_simulation();
+
+bool simulation_ready();
+bool simulation_halted();
+unsigned simulated_pc();
+unsigned simulated_register(int reg);
+unsigned simulated_memory(unsigned addr);
+long simulated_instructions();
+
+// Observer that watches nothing. A Simulator without an observer records no events,
+// so stepping it is the same loop the command line runs.
+struct NoObserver {};
+
+/*
+	An E20 simulation driven one instruction at a time.
+
+	The simulator keeps its state in globals, so a program can have only one
+	Simulator, and only on one thread.
+
+	@param Observer A type with a method void cache_event(const CacheEvent &),
+		called with every cache event after the instruction that caused it,
+		or NoObserver. Each Simulator calls its own observer.
+*/
+template <class Observer = NoObserver>
+class Simulator {
+public:
+	// Takes the command-line arguments of simcache, without the program name
+	// (e.g. {"--cache", "8,2,1", "--quiet", "prog.bin"}) and an observer
+	Simulator(const std::vector<std::string> &args, Observer observer = Observer()) : watcher(observer) {
+		std::vector<char *> argv = {(char *)"simcache"};
+		for (const std::string &arg : args)
+			argv.push_back((char *)arg.c_str());
+		ready = setup_simulation(argv.size(), argv.data()) == 0 && simulation_ready();
+		record_cache_events = OBSERVED;
+		cache_events.clear();
+	}
+
+	~Simulator() {
+		record_cache_events = false;
+		cache_events.clear();
+	}
+
+	Simulator(const Simulator &) = delete;
+	Simulator &operator=(const Simulator &) = delete;
+
+	// Returns false if the arguments were invalid or named no cache
+	bool ok() const {
+		return ready;
+	}
+
+	// Takes a number of instructions
+	// Runs them, stopping early if the program halts
+	// Returns the number run
+	long step(long count = 1) {
+		return run_until([count](const Simulator &, long run) { return run >= count; });
+	}
+
+	// Takes a pc
+	// Runs until the next instruction to run is at that pc, or the program halts
+	// Returns the number of instructions run
+	long run_until_pc(unsigned target) {
+		return run_until([target](const Simulator &sim, long) { return sim.pc() == target; });
+	}
+
+	// Takes a predicate called as done(simulator, instructions run so far) before each
+	// instruction
+	// Runs until it returns true or the program halts
+	// Returns the number of instructions run
+	template <class Predicate>
+	long run_until(Predicate done) {
+		long run = 0;
+		while (ready && !done(*this, run)) {
+			bool ran = simulate_instruction();
+			deliver_events();
+			if (!ran)
+				break;
+			run++;
+		}
+		return run;
+	}
+
+	// Runs the program until it halts, on host threads if --threads or --host-pipeline
+	// was given. With an observer it steps on this thread instead, so the observer
+	// sees every event in order.
+	// Returns the number of instructions run
+	long run() {
+		if constexpr (OBSERVED)
+			return run_until([](const Simulator &, long) { return false; });
+		long before = simulated_instructions();
+		if (ready)
+			run_simulation();
+		return simulated_instructions() - before;
+	}
+
+	// Prints the statistics and writes the profiles asked for in the arguments
+	// Returns 0, or 1 if a profile couldn't be written
+	int finish() {
+		return ready ? finish_simulation() : 1;
+	}
+
+	bool halted() const {
+		return simulation_halted();
+	}
+
+	// Returns the pc of the next instruction, of the core whose turn it is
+	unsigned pc() const {
+		return simulated_pc();
+	}
+
+	// Takes a register number and returns its value in the core whose turn it is
+	unsigned reg(int number) const {
+		return simulated_register(number);
+	}
+
+	unsigned memory(unsigned addr) const {
+		return simulated_memory(addr);
+	}
+
+	long instructions() const {
+		return simulated_instructions();
+	}
+
+	Observer &observer() {
+		return watcher;
+	}
+
+private:
+	static constexpr bool OBSERVED = !std::is_same<Observer, NoObserver>::value;
+
+	Observer watcher;
+	bool ready = false;
+
+	// Passes the events recorded since the last call to the observer
+	void deliver_events() {
+		if constexpr (OBSERVED) {
+			for (const CacheEvent &event : cache_events)
+				watcher.cache_event(event);
+			cache_events.clear();
+		}
+	}
+};
+
+#endif
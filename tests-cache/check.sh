@@ -0,0 +1,90 @@
+#!/bin/bash
+# Regression check of the tests-cache programs (make check). Each program with a
+# .bin must assemble with asm -g to it, and each run listed under its
+# "#--EXECUTION OUTPUT" as "# NAME.bin OPTIONS" must print the lines that follow
+# it, each written "# <tab>LINE". A run written "# $ COMMAND" instead runs the shell
+# command from the top of the tree, with $tmp naming a scratch directory, for the
+# options of asm and link and for runs of several commands. Runs that print the log without a miss class are
+# repeated with tests-cache/observer.exe, a client of the simcache library that
+# prints the log from an observer, when make check has built it.
+
+cd "$(dirname "$0")/.."
+failed=0
+runs=0
+
+# Takes the options and the .bin of a run and the file holding its expected output
+check_run() {
+	runs=$((runs + 1))
+	if ! ./simcache.exe $1 "$2" 2>&1 | diff -q - "$3" > /dev/null; then
+		echo "Output differs: $2 $1"
+		failed=$((failed + 1))
+	fi
+	if [ -x tests-cache/observer.exe ] && [[ " $1 " != *" --quiet "* && " $1 " != *" --classify "* ]]; then
+		runs=$((runs + 1))
+		if ! ./tests-cache/observer.exe $1 "$2" 2>&1 | diff -q - "$3" > /dev/null; then
+			echo "Observer output differs: $2 $1"
+			failed=$((failed + 1))
+		fi
+	fi
+}
+
+# Takes a shell command and the file holding its expected output
+check_command() {
+	runs=$((runs + 1))
+	rm -rf "$tmp"/*
+	if ! tmp="$tmp" bash -c "$1" 2>&1 | diff -q - "$2" > /dev/null; then
+		echo "Output differs: $1"
+		failed=$((failed + 1))
+	fi
+}
+
+# Takes the kind of the run ("bin" or "command"), its options or command, the .bin
+# and the file holding the expected output
+check_any() {
+	if [ "$1" = "command" ]; then
+		check_command "$2" "$4"
+	else
+		check_run "$2" "$3" "$4"
+	fi
+}
+
+expected=$(mktemp)
+tmp=$(mktemp -d)
+trap 'rm -f "$expected"; rm -rf "$tmp"' EXIT
+for source in tests-cache/*.s; do
+	binary="${source%.s}.bin"
+	if [ -f "$binary" ] && ! ./asm.exe -g "$source" | cmp -s - "$binary"; then
+		echo "Machine code differs: $source"
+		failed=$((failed + 1))
+	fi
+
+	kind=""
+	options=""
+	in_output=false
+	while IFS= read -r line; do
+		if [ "$line" = "#--EXECUTION OUTPUT" ]; then
+			in_output=true
+		elif ! $in_output; then
+			continue
+		elif [[ "$line" =~ ^#\ \$\ (.*)$ ]]; then
+			kind="command"
+			options="${BASH_REMATCH[1]}"
+			: > "$expected"
+		elif [[ "$line" =~ ^#\ [^[:space:]]+\.bin\ (.*)$ ]]; then
+			kind="bin"
+			options="${BASH_REMATCH[1]}"
+			: > "$expected"
+		elif [[ "$line" == "# "$'\t'* ]]; then
+			printf '%s\n' "${line:3}" >> "$expected"
+		elif [ -n "$kind" ]; then
+			check_any "$kind" "$options" "$binary" "$expected"
+			kind=""
+		fi
+	done < "$source"
+	if [ -n "$kind" ]; then
+		check_any "$kind" "$options" "$binary" "$expected"
+	fi
+done
+
+echo "$runs runs, $failed failures"
+[ $failed -eq 0 ]
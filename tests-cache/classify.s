@@ -0,0 +1,77 @@
+# Misses of each class in a 4-word direct-mapped cache under --classify. Loads of
+# 20 and 24 share row 0, so after their compulsory misses they miss on conflict.
+# A sweep of six new words misses compulsorily, and the load of its first word
+# after it misses on capacity, since even a fully-associative LRU cache of four
+# words has evicted it.
+# An L2 of 2-word blocks below it only misses on the five blocks it never held.
+
+    lw $1, 20($0)   # compulsory
+    lw $1, 24($0)   # compulsory, evicts 20 from row 0
+    lw $1, 20($0)   # conflict: a fully-associative cache would still hold 20
+    lw $1, 24($0)   # conflict
+    movi $2, 30
+    movi $3, 6
+sweep:
+    lw $1, 0($2)    # compulsory, six words through a four-word cache
+    addi $2, $2, 1
+    addi $3, $3, -1
+    jeq $3, $0, again
+    j sweep
+again:
+    lw $1, 30($0)   # capacity: too many words since 30 for any four-word cache
+    halt
+#--
+#--
+#--MACHINE CODE
+# ram[0] = 16'b1000000010010100;		// lw $1,20($0)
+# ram[1] = 16'b1000000010011000;		// lw $1,24($0)
+# ram[2] = 16'b1000000010010100;		// lw $1,20($0)
+# ram[3] = 16'b1000000010011000;		// lw $1,24($0)
+# ram[4] = 16'b0010000100011110;		// movi $2,30
+# ram[5] = 16'b0010000110000110;		// movi $3,6
+# ram[6] = 16'b1000100010000000;		// sweep: lw $1,0($2)
+# ram[7] = 16'b0010100100000001;		// addi $2,$2,1
+# ram[8] = 16'b0010110111111111;		// addi $3,$3,-1
+# ram[9] = 16'b1100110000000001;		// jeq $3,$0,again
+# ram[10] = 16'b0100000000000110;		// j sweep
+# ram[11] = 16'b1000000010011110;		// again: lw $1,30($0)
+# ram[12] = 16'b0100000000001100;		// halt 
+#--
+#--
+#--EXECUTION OUTPUT
+# classify.bin --cache 4,1,1 --classify
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	L1 MISS  pc:    0	addr:   20	row:   0	compulsory
+# 	L1 MISS  pc:    1	addr:   24	row:   0	compulsory
+# 	L1 MISS  pc:    2	addr:   20	row:   0	conflict
+# 	L1 MISS  pc:    3	addr:   24	row:   0	conflict
+# 	L1 MISS  pc:    6	addr:   30	row:   2	compulsory
+# 	L1 MISS  pc:    6	addr:   31	row:   3	compulsory
+# 	L1 MISS  pc:    6	addr:   32	row:   0	compulsory
+# 	L1 MISS  pc:    6	addr:   33	row:   1	compulsory
+# 	L1 MISS  pc:    6	addr:   34	row:   2	compulsory
+# 	L1 MISS  pc:    6	addr:   35	row:   3	compulsory
+# 	L1 MISS  pc:   11	addr:   30	row:   2	capacity
+# 	Misses L1 compulsory 8, capacity 1, conflict 2
+# 	  pc:    0 compulsory 1, capacity 0, conflict 0
+# 	  pc:    1 compulsory 1, capacity 0, conflict 0
+# 	  pc:    2 compulsory 0, capacity 0, conflict 1
+# 	  pc:    3 compulsory 0, capacity 0, conflict 1
+# 	  pc:    6 compulsory 6, capacity 0, conflict 0
+# 	  pc:   11 compulsory 0, capacity 1, conflict 0
+# 
+# classify.bin --cache 4,1,1,16,2,2 --classify --quiet
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	Cache L2 has size 16, associativity 2, blocksize 2, rows 4
+# 	Misses L1 compulsory 8, capacity 1, conflict 2
+# 	  pc:    0 compulsory 1, capacity 0, conflict 0
+# 	  pc:    1 compulsory 1, capacity 0, conflict 0
+# 	  pc:    2 compulsory 0, capacity 0, conflict 1
+# 	  pc:    3 compulsory 0, capacity 0, conflict 1
+# 	  pc:    6 compulsory 6, capacity 0, conflict 0
+# 	  pc:   11 compulsory 0, capacity 1, conflict 0
+# 	Misses L2 compulsory 5, capacity 0, conflict 0
+# 	  pc:    0 compulsory 1, capacity 0, conflict 0
+# 	  pc:    1 compulsory 1, capacity 0, conflict 0
+# 	  pc:    6 compulsory 3, capacity 0, conflict 0
+# 
@@ -0,0 +1,96 @@
+# Two cores, one starting at 0 and one at 4, share 30 and 31 through their private
+# L1s, named L1.0 and L1.1, and run one instruction each in turn. A write removes
+# the other core's copy, logged as INV against that core's L1.
+
+movi $1, 7
+sw $1, 30($0)   # core 1 read 30 just before, so its copy goes
+lw $2, 31($0)   # core 1 just wrote 31
+halt
+lw $3, 30($0)
+sw $3, 31($0)
+lw $4, 30($0)
+halt
+#--
+#--
+#--MACHINE CODE
+# ram[0] = 16'b0010000010000111;		// movi $1,7
+# ram[1] = 16'b1010000010011110;		// sw $1,30($0)
+# ram[2] = 16'b1000000100011111;		// lw $2,31($0)
+# ram[3] = 16'b0100000000000011;		// halt 
+# ram[4] = 16'b1000000110011110;		// lw $3,30($0)
+# ram[5] = 16'b1010000110011111;		// sw $3,31($0)
+# ram[6] = 16'b1000001000011110;		// lw $4,30($0)
+# ram[7] = 16'b0100000000000111;		// halt 
+#--
+#--
+#--EXECUTION OUTPUT
+# coherence.bin --cache 4,1,1 --cores 2 --entry 0,4
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	L1.1 MISS pc:    4	addr:   30	row:   2
+# 	L1.1 INV pc:    1	addr:   30	row:   2
+# 	L1.0 SW  pc:    1	addr:   30	row:   2
+# 	L1.1 SW  pc:    5	addr:   31	row:   3
+# 	L1.0 MISS pc:    2	addr:   31	row:   3
+# 	L1.1 MISS pc:    6	addr:   30	row:   2
+# 	Core 0 instructions 4, coherence misses 0, invalidations 0, upgrades 0, flushes 0
+# 	Core 1 instructions 4, coherence misses 1, invalidations 1, upgrades 0, flushes 0
+# 
+# coherence.bin --cache 4,1,1 --cores 2 --entry 0,4 --write-policy wb
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	L1.1 MISS pc:    4	addr:   30	row:   2
+# 	L1.1 INV pc:    1	addr:   30	row:   2
+# 	L1.0 SW  pc:    1	addr:   30	row:   2
+# 	L1.1 SW  pc:    5	addr:   31	row:   3
+# 	L1.0 MISS pc:    2	addr:   31	row:   3
+# 	L1.1 WB  pc:    2	addr:   31	row:   3
+# 	L1.1 MISS pc:    6	addr:   30	row:   2
+# 	L1.0 WB  pc:    6	addr:   30	row:   2
+# 	Core 0 instructions 4, coherence misses 0, invalidations 0, upgrades 0, flushes 1
+# 	Core 1 instructions 4, coherence misses 1, invalidations 1, upgrades 0, flushes 1
+# 
+# coherence.bin --cache 4,1,1 --cores 2 --entry 0,4 --write-policy wb --coherence msi
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	L1.1 MISS pc:    4	addr:   30	row:   2
+# 	L1.1 INV pc:    1	addr:   30	row:   2
+# 	L1.0 SW  pc:    1	addr:   30	row:   2
+# 	L1.1 SW  pc:    5	addr:   31	row:   3
+# 	L1.0 MISS pc:    2	addr:   31	row:   3
+# 	L1.1 WB  pc:    2	addr:   31	row:   3
+# 	L1.1 MISS pc:    6	addr:   30	row:   2
+# 	L1.0 WB  pc:    6	addr:   30	row:   2
+# 	Core 0 instructions 4, coherence misses 0, invalidations 0, upgrades 0, flushes 1
+# 	Core 1 instructions 4, coherence misses 1, invalidations 1, upgrades 0, flushes 1
+# 
+# coherence.bin --cache 4,1,1,16,2,1 --cores 2 --entry 0,4 --write-policy wb
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	Cache L2 has size 16, associativity 2, blocksize 1, rows 8
+# 	L1.1 MISS pc:    4	addr:   30	row:   2
+# 	L2 MISS  pc:    4	addr:   30	row:   6
+# 	L1.1 INV pc:    1	addr:   30	row:   2
+# 	L1.0 SW  pc:    1	addr:   30	row:   2
+# 	L1.1 SW  pc:    5	addr:   31	row:   3
+# 	L1.0 MISS pc:    2	addr:   31	row:   3
+# 	L1.1 WB  pc:    2	addr:   31	row:   3
+# 	L2 HIT   pc:    2	addr:   31	row:   7
+# 	L1.1 MISS pc:    6	addr:   30	row:   2
+# 	L1.0 WB  pc:    6	addr:   30	row:   2
+# 	L2 HIT   pc:    6	addr:   30	row:   6
+# 	Core 0 instructions 4, coherence misses 0, invalidations 0, upgrades 0, flushes 1
+# 	Core 1 instructions 4, coherence misses 1, invalidations 1, upgrades 0, flushes 1
+# 
+# coherence.bin --cache 4,1,1 --cores 2 --entry 0,4 --write-policy wb --stats
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	L1.1 MISS pc:    4	addr:   30	row:   2
+# 	L1.1 INV pc:    1	addr:   30	row:   2
+# 	L1.0 SW  pc:    1	addr:   30	row:   2
+# 	L1.1 SW  pc:    5	addr:   31	row:   3
+# 	L1.0 MISS pc:    2	addr:   31	row:   3
+# 	L1.1 WB  pc:    2	addr:   31	row:   3
+# 	L1.1 MISS pc:    6	addr:   30	row:   2
+# 	L1.0 WB  pc:    6	addr:   30	row:   2
+# 	Cache L1.0 reads 1 (hits 0, misses 1), writes 1 (hits 0, misses 1), writebacks 0
+# 	Cache L1.1 reads 2 (hits 0, misses 2), writes 1 (hits 0, misses 1), writebacks 0
+# 	Memory words read 5, words written 2
+# 	Core 0 instructions 4, coherence misses 0, invalidations 0, upgrades 0, flushes 1
+# 	Core 1 instructions 4, coherence misses 1, invalidations 1, upgrades 0, flushes 1
+# 
@@ -0,0 +1,115 @@
+# Loads and stores through two write-back levels, a victim cache and next-line
+# prefetchers, with --classify. --host-pipeline runs the cache model and the log
+# on threads of their own, so each pair of runs, without and with it, must print
+# the same output, in the same order.
+
+    movi $1, 3
+loop:
+    lw $2, 20($1)
+    sw $2, 30($1)
+    lw $3, 38($1)
+    addi $1, $1, -1
+    jeq $1, $0, done
+    j loop
+done:
+    lw $3, 21($0)
+    halt
+#--
+#--
+#--MACHINE CODE
+# ram[0] = 16'b0010000010000011;		// movi $1,3
+# ram[1] = 16'b1000010100010100;		// loop: lw $2,20($1)
+# ram[2] = 16'b1010010100011110;		// sw $2,30($1)
+# ram[3] = 16'b1000010110100110;		// lw $3,38($1)
+# ram[4] = 16'b0010010011111111;		// addi $1,$1,-1
+# ram[5] = 16'b1100010000000001;		// jeq $1,$0,done
+# ram[6] = 16'b0100000000000001;		// j loop
+# ram[7] = 16'b1000000110010101;		// done: lw $3,21($0)
+# ram[8] = 16'b0100000000001000;		// halt 
+#--
+#--
+#--EXECUTION OUTPUT
+# hostpipeline.bin --cache 8,2,2,32,2,4 --write-policy wb --victim 2 --prefetch nextline --classify
+# 	Cache L1 has size 8, associativity 2, blocksize 2, rows 2
+# 	Cache L2 has size 32, associativity 2, blocksize 4, rows 4
+# 	L1 MISS  pc:    1	addr:   23	row:   1	compulsory
+# 	VC MISS  pc:    1	addr:   23	row:   0
+# 	L2 MISS  pc:    1	addr:   23	row:   1	compulsory
+# 	L1 PF    pc:    1	addr:   24	row:   0
+# 	L1 SW    pc:    2	addr:   33	row:   0
+# 	L1 MISS  pc:    3	addr:   41	row:   0	compulsory
+# 	VC MISS  pc:    3	addr:   41	row:   0
+# 	L2 MISS  pc:    3	addr:   41	row:   2	compulsory
+# 	L1 PF    pc:    3	addr:   42	row:   1
+# 	L2 PF    pc:    3	addr:   44	row:   3
+# 	L1 HIT   pc:    1	addr:   22	row:   1
+# 	L1 SW    pc:    2	addr:   32	row:   0
+# 	L1 HIT   pc:    3	addr:   40	row:   0
+# 	L1 MISS  pc:    1	addr:   21	row:   0	compulsory
+# 	VC MISS  pc:    1	addr:   21	row:   0
+# 	L2 HIT   pc:    1	addr:   21	row:   1
+# 	L1 SW    pc:    2	addr:   31	row:   1
+# 	L1 MISS  pc:    3	addr:   39	row:   1	compulsory
+# 	VC MISS  pc:    3	addr:   39	row:   0
+# 	L2 MISS  pc:    3	addr:   39	row:   1	compulsory
+# 	VC WB    pc:    3	addr:   32	row:   1
+# 	L1 HIT   pc:    7	addr:   21	row:   0
+# 	Prefetch L1 nextline: issued 2, useful 0, useless 2, dropped 0, accuracy 0.00%, coverage 0.00%, misses avoided 0
+# 	Prefetch L2 nextline: issued 1, useful 0, useless 0, dropped 0, accuracy 0.00%, coverage 0.00%, misses avoided 0
+# 	Misses L1 compulsory 4, capacity 0, conflict 0
+# 	  pc:    1 compulsory 2, capacity 0, conflict 0
+# 	  pc:    3 compulsory 2, capacity 0, conflict 0
+# 	Misses L2 compulsory 3, capacity 0, conflict 0
+# 	  pc:    1 compulsory 1, capacity 0, conflict 0
+# 	  pc:    3 compulsory 2, capacity 0, conflict 0
+# 
+# hostpipeline.bin --cache 8,2,2,32,2,4 --write-policy wb --victim 2 --prefetch nextline --classify --host-pipeline
+# 	Cache L1 has size 8, associativity 2, blocksize 2, rows 2
+# 	Cache L2 has size 32, associativity 2, blocksize 4, rows 4
+# 	L1 MISS  pc:    1	addr:   23	row:   1	compulsory
+# 	VC MISS  pc:    1	addr:   23	row:   0
+# 	L2 MISS  pc:    1	addr:   23	row:   1	compulsory
+# 	L1 PF    pc:    1	addr:   24	row:   0
+# 	L1 SW    pc:    2	addr:   33	row:   0
+# 	L1 MISS  pc:    3	addr:   41	row:   0	compulsory
+# 	VC MISS  pc:    3	addr:   41	row:   0
+# 	L2 MISS  pc:    3	addr:   41	row:   2	compulsory
+# 	L1 PF    pc:    3	addr:   42	row:   1
+# 	L2 PF    pc:    3	addr:   44	row:   3
+# 	L1 HIT   pc:    1	addr:   22	row:   1
+# 	L1 SW    pc:    2	addr:   32	row:   0
+# 	L1 HIT   pc:    3	addr:   40	row:   0
+# 	L1 MISS  pc:    1	addr:   21	row:   0	compulsory
+# 	VC MISS  pc:    1	addr:   21	row:   0
+# 	L2 HIT   pc:    1	addr:   21	row:   1
+# 	L1 SW    pc:    2	addr:   31	row:   1
+# 	L1 MISS  pc:    3	addr:   39	row:   1	compulsory
+# 	VC MISS  pc:    3	addr:   39	row:   0
+# 	L2 MISS  pc:    3	addr:   39	row:   1	compulsory
+# 	VC WB    pc:    3	addr:   32	row:   1
+# 	L1 HIT   pc:    7	addr:   21	row:   0
+# 	Prefetch L1 nextline: issued 2, useful 0, useless 2, dropped 0, accuracy 0.00%, coverage 0.00%, misses avoided 0
+# 	Prefetch L2 nextline: issued 1, useful 0, useless 0, dropped 0, accuracy 0.00%, coverage 0.00%, misses avoided 0
+# 	Misses L1 compulsory 4, capacity 0, conflict 0
+# 	  pc:    1 compulsory 2, capacity 0, conflict 0
+# 	  pc:    3 compulsory 2, capacity 0, conflict 0
+# 	Misses L2 compulsory 3, capacity 0, conflict 0
+# 	  pc:    1 compulsory 1, capacity 0, conflict 0
+# 	  pc:    3 compulsory 2, capacity 0, conflict 0
+# 
+# hostpipeline.bin --cache 8,2,2,32,2,4 --write-policy wb --victim 2 --quiet --stats
+# 	Cache L1 has size 8, associativity 2, blocksize 2, rows 2
+# 	Cache L2 has size 32, associativity 2, blocksize 4, rows 4
+# 	Cache L1 reads 7 (hits 3, misses 4), writes 3 (hits 1, misses 2), writebacks 0
+# 	Cache L2 reads 4 (hits 1, misses 3), writes 0 (hits 0, misses 0), writebacks 0
+# 	Victim cache entries 2, hits 0, misses 4
+# 	Memory words read 20, words written 0
+# 
+# hostpipeline.bin --cache 8,2,2,32,2,4 --write-policy wb --victim 2 --quiet --stats --host-pipeline
+# 	Cache L1 has size 8, associativity 2, blocksize 2, rows 2
+# 	Cache L2 has size 32, associativity 2, blocksize 4, rows 4
+# 	Cache L1 reads 7 (hits 3, misses 4), writes 3 (hits 1, misses 2), writebacks 0
+# 	Cache L2 reads 4 (hits 1, misses 3), writes 0 (hits 0, misses 0), writebacks 0
+# 	Victim cache entries 2, hits 0, misses 4
+# 	Memory words read 20, words written 0
+# 
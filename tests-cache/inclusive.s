@@ -0,0 +1,63 @@
+# An inclusive L2 invalidates, logged as INV, the copies above it of every block
+# it evicts. Addresses 1 and 9 share a row of the 8-row L2 but not of the 2-row L1.
+
+lw $1, 1($0)
+lw $2, 3($0)
+lw $3, 9($0)    # L2 evicts 1, so L1 (or its victim cache) loses it too
+lw $4, 1($0)
+halt
+#--
+#--
+#--MACHINE CODE
+# ram[0] = 16'b1000000010000001;		// lw $1,1($0)
+# ram[1] = 16'b1000000100000011;		// lw $2,3($0)
+# ram[2] = 16'b1000000110001001;		// lw $3,9($0)
+# ram[3] = 16'b1000001000000001;		// lw $4,1($0)
+# ram[4] = 16'b0100000000000100;		// halt 
+#--
+#--
+#--EXECUTION OUTPUT
+# inclusive.bin --cache 4,2,1,8,1,1 --l2-mode inclusive
+# 	Cache L1 has size 4, associativity 2, blocksize 1, rows 2
+# 	Cache L2 has size 8, associativity 1, blocksize 1, rows 8
+# 	L1 MISS  pc:    0	addr:    1	row:   1
+# 	L2 MISS  pc:    0	addr:    1	row:   1
+# 	L1 MISS  pc:    1	addr:    3	row:   1
+# 	L2 MISS  pc:    1	addr:    3	row:   3
+# 	L1 MISS  pc:    2	addr:    9	row:   1
+# 	L2 MISS  pc:    2	addr:    9	row:   1
+# 	L1 INV   pc:    2	addr:    1	row:   1
+# 	L1 MISS  pc:    3	addr:    1	row:   1
+# 	L2 MISS  pc:    3	addr:    1	row:   1
+# 	L1 INV   pc:    3	addr:    9	row:   1
+# 
+# inclusive.bin --cache 4,2,1,8,1,1 --l2-mode nine
+# 	Cache L1 has size 4, associativity 2, blocksize 1, rows 2
+# 	Cache L2 has size 8, associativity 1, blocksize 1, rows 8
+# 	L1 MISS  pc:    0	addr:    1	row:   1
+# 	L2 MISS  pc:    0	addr:    1	row:   1
+# 	L1 MISS  pc:    1	addr:    3	row:   1
+# 	L2 MISS  pc:    1	addr:    3	row:   3
+# 	L1 MISS  pc:    2	addr:    9	row:   1
+# 	L2 MISS  pc:    2	addr:    9	row:   1
+# 	L1 MISS  pc:    3	addr:    1	row:   1
+# 	L2 MISS  pc:    3	addr:    1	row:   1
+# 
+# inclusive.bin --cache 2,1,1,8,1,1 --l2-mode inclusive --victim 1
+# 	Cache L1 has size 2, associativity 1, blocksize 1, rows 2
+# 	Cache L2 has size 8, associativity 1, blocksize 1, rows 8
+# 	L1 MISS  pc:    0	addr:    1	row:   1
+# 	VC MISS  pc:    0	addr:    1	row:   0
+# 	L2 MISS  pc:    0	addr:    1	row:   1
+# 	L1 MISS  pc:    1	addr:    3	row:   1
+# 	VC MISS  pc:    1	addr:    3	row:   0
+# 	L2 MISS  pc:    1	addr:    3	row:   3
+# 	L1 MISS  pc:    2	addr:    9	row:   1
+# 	VC MISS  pc:    2	addr:    9	row:   0
+# 	L2 MISS  pc:    2	addr:    9	row:   1
+# 	VC INV   pc:    2	addr:    1	row:   0
+# 	L1 MISS  pc:    3	addr:    1	row:   1
+# 	VC MISS  pc:    3	addr:    1	row:   0
+# 	L2 MISS  pc:    3	addr:    1	row:   1
+# 	L1 INV   pc:    3	addr:    9	row:   1
+# 
@@ -0,0 +1,110 @@
+# Two passes summing a[i] and b[i] for four words each. .align puts a at 16, the
+# start of a block, .space 2 ends a with two zeros and .space 4 leaves b eight
+# words after a, so a[i] and b[i] share a row of an 8-word direct-mapped cache of
+# 2-word blocks and every load misses. asm --layout for that cache pads b by two
+# words, which cuts the misses from 16 to 6.
+
+    movi $1, 0              # index
+    movi $6, 2              # passes
+elem:
+    lw $2, a($1)
+    lw $3, b($1)
+    add $4, $4, $2
+    add $4, $4, $3
+    addi $1, $1, 1
+    slti $2, $1, 4
+    jeq $2, $0, endpass
+    j elem
+endpass:
+    movi $1, 0
+    addi $6, $6, -1
+    jeq $6, $0, done
+    j elem
+done:
+    halt
+
+    .align 8
+a:  .fill 1
+    .fill 2
+    .space 2
+    .space 4
+b:  .fill 3
+    .fill 4
+    .fill 5
+    .fill 6
+#--
+#--
+#--MACHINE CODE
+# ram[0] = 16'b0010000010000000;		// movi $1,0
+# ram[1] = 16'b0010001100000010;		// movi $6,2
+# ram[2] = 16'b1000010100010000;		// elem: lw $2,a($1)
+# ram[3] = 16'b1000010110011000;		// lw $3,b($1)
+# ram[4] = 16'b0001000101000000;		// add $4,$4,$2
+# ram[5] = 16'b0001000111000000;		// add $4,$4,$3
+# ram[6] = 16'b0010010010000001;		// addi $1,$1,1
+# ram[7] = 16'b1110010100000100;		// slti $2,$1,4
+# ram[8] = 16'b1100100000000001;		// jeq $2,$0,endpass
+# ram[9] = 16'b0100000000000010;		// j elem
+# ram[10] = 16'b0010000010000000;		// endpass: movi $1,0
+# ram[11] = 16'b0011101101111111;		// addi $6,$6,-1
+# ram[12] = 16'b1101100000000001;		// jeq $6,$0,done
+# ram[13] = 16'b0100000000000010;		// j elem
+# ram[14] = 16'b0100000000001110;		// done: halt 
+# ram[15] = 16'b0000000000000000;		// .fill 0
+# ram[16] = 16'b0000000000000001;		// a: .fill 1
+# ram[17] = 16'b0000000000000010;		// .fill 2
+# ram[18] = 16'b0000000000000000;		// .fill 0
+# ram[19] = 16'b0000000000000000;		// .fill 0
+# ram[20] = 16'b0000000000000000;		// .fill 0
+# ram[21] = 16'b0000000000000000;		// .fill 0
+# ram[22] = 16'b0000000000000000;		// .fill 0
+# ram[23] = 16'b0000000000000000;		// .fill 0
+# ram[24] = 16'b0000000000000011;		// b: .fill 3
+# ram[25] = 16'b0000000000000100;		// .fill 4
+# ram[26] = 16'b0000000000000101;		// .fill 5
+# ram[27] = 16'b0000000000000110;		// .fill 6
+#--
+#--
+#--EXECUTION OUTPUT
+# layout.bin --cache 8,1,2 --quiet --stats
+# 	Cache L1 has size 8, associativity 1, blocksize 2, rows 4
+# 	Cache L1 reads 16 (hits 0, misses 16), writes 0 (hits 0, misses 0), writebacks 0
+# 	Memory words read 32, words written 0
+# 
+# $ ./asm.exe --layout 8,1,2 -g tests-cache/layout.s
+# 	ram[0] = 16'b0010000010000000;		// movi $1,0
+# 	ram[1] = 16'b0010001100000010;		// movi $6,2
+# 	ram[2] = 16'b1000010100010000;		// elem: lw $2,a($1)
+# 	ram[3] = 16'b1000010110011010;		// lw $3,b($1)
+# 	ram[4] = 16'b0001000101000000;		// add $4,$4,$2
+# 	ram[5] = 16'b0001000111000000;		// add $4,$4,$3
+# 	ram[6] = 16'b0010010010000001;		// addi $1,$1,1
+# 	ram[7] = 16'b1110010100000100;		// slti $2,$1,4
+# 	ram[8] = 16'b1100100000000001;		// jeq $2,$0,endpass
+# 	ram[9] = 16'b0100000000000010;		// j elem
+# 	ram[10] = 16'b0010000010000000;		// endpass: movi $1,0
+# 	ram[11] = 16'b0011101101111111;		// addi $6,$6,-1
+# 	ram[12] = 16'b1101100000000001;		// jeq $6,$0,done
+# 	ram[13] = 16'b0100000000000010;		// j elem
+# 	ram[14] = 16'b0100000000001110;		// done: halt 
+# 	ram[15] = 16'b0000000000000000;		// .fill 0
+# 	ram[16] = 16'b0000000000000001;		// a: .fill 1
+# 	ram[17] = 16'b0000000000000010;		// .fill 2
+# 	ram[18] = 16'b0000000000000000;		// .fill 0
+# 	ram[19] = 16'b0000000000000000;		// .fill 0
+# 	ram[20] = 16'b0000000000000000;		// .fill 0
+# 	ram[21] = 16'b0000000000000000;		// .fill 0
+# 	ram[22] = 16'b0000000000000000;		// .fill 0
+# 	ram[23] = 16'b0000000000000000;		// .fill 0
+# 	ram[24] = 16'b0000000000000000;		// .fill 0
+# 	ram[25] = 16'b0000000000000000;		// .fill 0
+# 	ram[26] = 16'b0000000000000011;		// b: .fill 3
+# 	ram[27] = 16'b0000000000000100;		// .fill 4
+# 	ram[28] = 16'b0000000000000101;		// .fill 5
+# 	ram[29] = 16'b0000000000000110;		// .fill 6
+# 
+# $ ./asm.exe --layout 8,1,2 tests-cache/layout.s | ./simcache.exe --cache 8,1,2 --quiet --stats /dev/stdin
+# 	Cache L1 has size 8, associativity 1, blocksize 2, rows 4
+# 	Cache L1 reads 16 (hits 10, misses 6), writes 0 (hits 0, misses 0), writebacks 0
+# 	Memory words read 12, words written 0
+# 
@@ -0,0 +1,72 @@
+# Stores to two addresses sharing a row of a 2-word direct-mapped L1, then loads.
+# The levels come from --level, from tests-cache/levels.cfg (the same two levels)
+# and from --cache followed by --level. Each level keeps its own write policy: the
+# write-back L1 of the first two logs WB as it evicts each dirty block, while the
+# L1 of --cache writes through, so its L2 logs SW.
+
+    movi $1, 7
+    sw $1, 20($0)   # L1 row 0, dirty in the write-back L1
+    sw $1, 22($0)   # evicts 20, written back to L2
+    lw $2, 20($0)   # evicts 22 and hits in L2
+    lw $3, 21($0)   # L1 row 1
+    lw $4, 23($0)   # evicts 21
+    halt
+#--
+#--
+#--MACHINE CODE
+# ram[0] = 16'b0010000010000111;		// movi $1,7
+# ram[1] = 16'b1010000010010100;		// sw $1,20($0)
+# ram[2] = 16'b1010000010010110;		// sw $1,22($0)
+# ram[3] = 16'b1000000100010100;		// lw $2,20($0)
+# ram[4] = 16'b1000000110010101;		// lw $3,21($0)
+# ram[5] = 16'b1000001000010111;		// lw $4,23($0)
+# ram[6] = 16'b0100000000000110;		// halt 
+#--
+#--
+#--EXECUTION OUTPUT
+# levels.bin --level 2,1,1,wb --level 8,2,1,wt
+# 	Cache L1 has size 2, associativity 1, blocksize 1, rows 2
+# 	Cache L2 has size 8, associativity 2, blocksize 1, rows 4
+# 	L1 SW    pc:    1	addr:   20	row:   0
+# 	L1 WB    pc:    2	addr:   20	row:   0
+# 	L1 SW    pc:    2	addr:   22	row:   0
+# 	L1 MISS  pc:    3	addr:   20	row:   0
+# 	L2 HIT   pc:    3	addr:   20	row:   0
+# 	L1 WB    pc:    3	addr:   22	row:   0
+# 	L1 MISS  pc:    4	addr:   21	row:   1
+# 	L2 MISS  pc:    4	addr:   21	row:   1
+# 	L1 MISS  pc:    5	addr:   23	row:   1
+# 	L2 MISS  pc:    5	addr:   23	row:   3
+# 
+# levels.bin --cache-file tests-cache/levels.cfg
+# 	Cache L1 has size 2, associativity 1, blocksize 1, rows 2
+# 	Cache L2 has size 8, associativity 2, blocksize 1, rows 4
+# 	L1 SW    pc:    1	addr:   20	row:   0
+# 	L1 WB    pc:    2	addr:   20	row:   0
+# 	L1 SW    pc:    2	addr:   22	row:   0
+# 	L1 MISS  pc:    3	addr:   20	row:   0
+# 	L2 HIT   pc:    3	addr:   20	row:   0
+# 	L1 WB    pc:    3	addr:   22	row:   0
+# 	L1 MISS  pc:    4	addr:   21	row:   1
+# 	L2 MISS  pc:    4	addr:   21	row:   1
+# 	L1 MISS  pc:    5	addr:   23	row:   1
+# 	L2 MISS  pc:    5	addr:   23	row:   3
+# 
+# levels.bin --cache 2,1,1 --level 8,2,1,wb,inclusive --stats
+# 	Cache L1 has size 2, associativity 1, blocksize 1, rows 2
+# 	Cache L2 has size 8, associativity 2, blocksize 1, rows 4
+# 	L1 SW    pc:    1	addr:   20	row:   0
+# 	L2 SW    pc:    1	addr:   20	row:   0
+# 	L1 SW    pc:    2	addr:   22	row:   0
+# 	L2 SW    pc:    2	addr:   22	row:   2
+# 	L1 MISS  pc:    3	addr:   20	row:   0
+# 	L2 HIT   pc:    3	addr:   20	row:   0
+# 	L1 MISS  pc:    4	addr:   21	row:   1
+# 	L2 MISS  pc:    4	addr:   21	row:   1
+# 	L1 MISS  pc:    5	addr:   23	row:   1
+# 	L2 MISS  pc:    5	addr:   23	row:   3
+# 	Cache L1 reads 3 (hits 0, misses 3), writes 2 (hits 0, misses 2), writebacks 0
+# 	Cache L2 reads 3 (hits 1, misses 2), writes 2 (hits 2, misses 0), writebacks 0
+# 	Back-invalidations 0
+# 	Memory words read 4, words written 0
+# 
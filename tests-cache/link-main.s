@@ -0,0 +1,68 @@
+# Entry module linked with link-lib.s. Each module is assembled with asm -c into
+# an object file, and link.exe places link-lib.o at 8, after this one, so lookup and
+# its table are relocated. The load of table must reach its linked address, 14.
+
+main:
+    movi $1, 1
+    jal lookup
+    sw $3, result($0)       # result = 22
+    movi $1, 5
+    jal lookup              # past the end: 0
+    add $4, $3, $0
+    halt
+
+result:
+    .fill 0
+#--
+#--
+#--EXECUTION OUTPUT
+# $ ./asm.exe -c tests-cache/link-lib.s
+# 	ram[0] = 16'b1110010100000011;
+# 	ram[1] = 16'b1100100000000010;
+# 	ram[2] = 16'b1000010110000110;
+# 	ram[3] = 16'b0100000000000101;
+# 	ram[4] = 16'b0010000110000000;
+# 	ram[5] = 16'b0001110000001000;
+# 	ram[6] = 16'b0000000000001011;
+# 	ram[7] = 16'b0000000000010110;
+# 	ram[8] = 16'b0000000000100001;
+# 	align 1
+# 	global lookup 0
+# 	reloc 2 imm
+# 	reloc 3 j
+# 
+# $ ./asm.exe -c tests-cache/link-main.s > $tmp/main.o && ./asm.exe -c tests-cache/link-lib.s > $tmp/lib.o && ./link.exe $tmp/main.o $tmp/lib.o
+# 	ram[0] = 16'b0010000010000001;
+# 	ram[1] = 16'b0110000000001000;
+# 	ram[2] = 16'b1010000110000111;
+# 	ram[3] = 16'b0010000010000101;
+# 	ram[4] = 16'b0110000000001000;
+# 	ram[5] = 16'b0000110001000000;
+# 	ram[6] = 16'b0100000000000110;
+# 	ram[7] = 16'b0000000000000000;
+# 	ram[8] = 16'b1110010100000011;
+# 	ram[9] = 16'b1100100000000010;
+# 	ram[10] = 16'b1000010110001110;
+# 	ram[11] = 16'b0100000000001101;
+# 	ram[12] = 16'b0010000110000000;
+# 	ram[13] = 16'b0001110000001000;
+# 	ram[14] = 16'b0000000000001011;
+# 	ram[15] = 16'b0000000000010110;
+# 	ram[16] = 16'b0000000000100001;
+# 
+# $ ./asm.exe -c tests-cache/link-main.s > $tmp/main.o && ./asm.exe -c tests-cache/link-lib.s > $tmp/lib.o && ./link.exe $tmp/main.o $tmp/lib.o | ./simcache.exe --cache 4,1,1 --dump-state 8 /dev/stdin
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	L1 MISS  pc:   10	addr:   15	row:   3
+# 	L1 SW    pc:    2	addr:    7	row:   3
+# 	Final state:
+# 		pc=    6
+# 		$0=    0
+# 		$1=    5
+# 		$2=    0
+# 		$3=    0
+# 		$4=    0
+# 		$5=    0
+# 		$6=    0
+# 		$7=    5
+# 	2081 6008 a187 2085 6008 0c40 4006 0016 
+# 
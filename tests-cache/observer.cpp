@@ -0,0 +1,40 @@
+/*
+observer.cpp
+
+Client of the simcache library, built against simcache.h and libsimcache.a by
+make check. Runs a program under the simcache options given, with the log turned
+off by --quiet and an observer printing every cache event as a log entry instead,
+so its output must match simcache.exe run with the same options.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include "simcache.h"
+
+using namespace std;
+
+// Prints each cache event as simcache logs it
+struct LogPrinter {
+	void cache_event(const CacheEvent &event) {
+		cout << left << setw(8) << event.cache + " " + event.status << right <<
+			" pc:" << setw(5) << event.pc <<
+			"\taddr:" << setw(5) << event.addr <<
+			"\trow:" << setw(4) << event.row << endl;
+	}
+};
+
+int main(int argc, char *argv[]) {
+	vector<string> args = {"--quiet"};
+	args.insert(args.end(), argv + 1, argv + argc);
+	Simulator<LogPrinter> sim(args);
+	if (!sim.ok())
+		return 1;
+
+	// Step the first instructions one at a time, then run the rest
+	for (int i = 0; i < 4 && !sim.halted(); i++)
+		sim.step();
+	sim.run();
+	return sim.finish();
+}
@@ -0,0 +1,129 @@
+# asm -O on a loop summing every other word of a table. It folds the constants
+# into movi, removes the nop, the write to $0, the overwritten movi and the jump
+# to the next instruction, merges the two addi and threads the jumps to jumps.
+# The optimized program must end with the same registers and the same cache
+# traffic as the program as written, at a different pc. -O refuses code that
+# only --entry could reach: an unlabeled instruction after a j.
+
+    movi $1, 5
+    addi $1, $1, 3          # $1 = 8, folded into movi
+    add $2, $1, $1          # $2 = 16, folded into movi
+    nop
+    add $0, $1, $2          # only writes $0
+    movi $3, 1              # overwritten before it is read
+    movi $3, 0
+loop:
+    lw $4, data($3)
+    add $5, $5, $4
+    addi $3, $3, 1          # merged with the next addi
+    addi $3, $3, 1
+    slti $6, $3, 4
+    jeq $6, $0, out         # threaded through out to end
+    j next                  # threaded through next to loop
+out:
+    j end
+next:
+    j loop
+end:
+    sw $5, sum($0)
+    j last                  # a jump to the next instruction
+last:
+    halt
+data:
+    .fill 1
+    .fill 2
+    .fill 3
+    .fill 4
+sum:
+    .fill 0
+#--
+#--
+#--MACHINE CODE
+# ram[0] = 16'b0010000010000101;		// movi $1,5
+# ram[1] = 16'b0010010010000011;		// addi $1,$1,3
+# ram[2] = 16'b0000010010100000;		// add $2,$1,$1
+# ram[3] = 16'b0000000000000000;		// nop 
+# ram[4] = 16'b0000010100000000;		// add $0,$1,$2
+# ram[5] = 16'b0010000110000001;		// movi $3,1
+# ram[6] = 16'b0010000110000000;		// movi $3,0
+# ram[7] = 16'b1000111000010011;		// loop: lw $4,data($3)
+# ram[8] = 16'b0001011001010000;		// add $5,$5,$4
+# ram[9] = 16'b0010110110000001;		// addi $3,$3,1
+# ram[10] = 16'b0010110110000001;		// addi $3,$3,1
+# ram[11] = 16'b1110111100000100;		// slti $6,$3,4
+# ram[12] = 16'b1101100000000001;		// jeq $6,$0,out
+# ram[13] = 16'b0100000000001111;		// j next
+# ram[14] = 16'b0100000000010000;		// out: j end
+# ram[15] = 16'b0100000000000111;		// next: j loop
+# ram[16] = 16'b1010001010010111;		// end: sw $5,sum($0)
+# ram[17] = 16'b0100000000010010;		// j last
+# ram[18] = 16'b0100000000010010;		// last: halt 
+# ram[19] = 16'b0000000000000001;		// data: .fill 1
+# ram[20] = 16'b0000000000000010;		// .fill 2
+# ram[21] = 16'b0000000000000011;		// .fill 3
+# ram[22] = 16'b0000000000000100;		// .fill 4
+# ram[23] = 16'b0000000000000000;		// sum: .fill 0
+#--
+#--
+#--EXECUTION OUTPUT
+# optimize.bin --cache 4,1,1 --quiet --stats --dump-state 1
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	Cache L1 reads 2 (hits 0, misses 2), writes 1 (hits 0, misses 1), writebacks 0
+# 	Memory words read 3, words written 1
+# 	Final state:
+# 		pc=   18
+# 		$0=    0
+# 		$1=    8
+# 		$2=   16
+# 		$3=    4
+# 		$4=    3
+# 		$5=    4
+# 		$6=    0
+# 		$7=    0
+# 	2085 
+# 
+# $ ./asm.exe -O -g tests-cache/optimize.s
+# 	ram[0] = 16'b0010000010001000;		// movi $1,8
+# 	ram[1] = 16'b0010000100010000;		// movi $2,16
+# 	ram[2] = 16'b0010000110000000;		// movi $3,0
+# 	ram[3] = 16'b1000111000010011;		// loop: lw $4,data($3)
+# 	ram[4] = 16'b0001011001010000;		// add $5,$5,$4
+# 	ram[5] = 16'b0010110110000010;		// addi $3,$3,2
+# 	ram[6] = 16'b1110111100000100;		// slti $6,$3,4
+# 	ram[7] = 16'b1101100000000011;		// jeq $6,$0,end
+# 	ram[8] = 16'b0100000000000011;		// j loop
+# 	ram[9] = 16'b0100000000001011;		// out: j end
+# 	ram[10] = 16'b0100000000000011;		// next: j loop
+# 	ram[11] = 16'b1010001010010111;		// end: sw $5,sum($0)
+# 	ram[12] = 16'b0100000000001100;		// last: halt 
+# 	ram[13] = 16'b0000000000000000;		// .fill 0
+# 	ram[14] = 16'b0000000000000000;		// .fill 0
+# 	ram[15] = 16'b0000000000000000;		// .fill 0
+# 	ram[16] = 16'b0000000000000000;		// .fill 0
+# 	ram[17] = 16'b0000000000000000;		// .fill 0
+# 	ram[18] = 16'b0000000000000000;		// .fill 0
+# 	ram[19] = 16'b0000000000000001;		// data: .fill 1
+# 	ram[20] = 16'b0000000000000010;		// .fill 2
+# 	ram[21] = 16'b0000000000000011;		// .fill 3
+# 	ram[22] = 16'b0000000000000100;		// .fill 4
+# 	ram[23] = 16'b0000000000000000;		// sum: .fill 0
+# 
+# $ ./asm.exe -O tests-cache/optimize.s | ./simcache.exe --cache 4,1,1 --quiet --stats --dump-state 1 /dev/stdin
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	Cache L1 reads 2 (hits 0, misses 2), writes 1 (hits 0, misses 1), writebacks 0
+# 	Memory words read 3, words written 1
+# 	Final state:
+# 		pc=   12
+# 		$0=    0
+# 		$1=    8
+# 		$2=   16
+# 		$3=    4
+# 		$4=    3
+# 		$5=    4
+# 		$6=    0
+# 		$7=    0
+# 	2088 
+# 
+# $ printf "j end\nmovi \$1, 1\nend:\nhalt\n" > $tmp/dead.s && ./asm.exe -O $tmp/dead.s
+# 	Can't optimize: the instruction at 1 follows a j with no label. Label it if --entry starts a core there
+# 
@@ -0,0 +1,115 @@
+# Ten passes over the top 64 words of memory, where the page table used to sit by
+# default, adding the pass number to each and copying it to words 64 to 127. Paging
+# without --page-table maps every page to itself outside memory, so each run must
+# end with the same final hash as the run without --paging.
+
+    movi $6, 32             # $6 = 8192, the end of memory
+    add $6, $6, $6
+    add $6, $6, $6
+    add $6, $6, $6
+    add $6, $6, $6
+    add $6, $6, $6
+    add $6, $6, $6
+    add $6, $6, $6
+    add $6, $6, $6
+    movi $7, 0              # pass number
+pass:
+    addi $7, $7, 1
+    addi $4, $6, -64        # pointer into the top 64 words
+    movi $5, 32             # pointer into words 64 to 127
+    add $5, $5, $5
+elem:
+    lw $3, 0($4)
+    add $3, $3, $7
+    sw $3, 0($4)
+    sw $3, 0($5)
+    addi $4, $4, 1
+    addi $5, $5, 1
+    slt $2, $4, $6
+    jeq $2, $0, endpass
+    j elem
+endpass:
+    slti $2, $7, 10
+    jeq $2, $0, done
+    j pass
+done:
+    halt
+#--
+#--
+#--MACHINE CODE
+# ram[0] = 16'b0010001100100000;		// movi $6,32
+# ram[1] = 16'b0001101101100000;		// add $6,$6,$6
+# ram[2] = 16'b0001101101100000;		// add $6,$6,$6
+# ram[3] = 16'b0001101101100000;		// add $6,$6,$6
+# ram[4] = 16'b0001101101100000;		// add $6,$6,$6
+# ram[5] = 16'b0001101101100000;		// add $6,$6,$6
+# ram[6] = 16'b0001101101100000;		// add $6,$6,$6
+# ram[7] = 16'b0001101101100000;		// add $6,$6,$6
+# ram[8] = 16'b0001101101100000;		// add $6,$6,$6
+# ram[9] = 16'b0010001110000000;		// movi $7,0
+# ram[10] = 16'b0011111110000001;		// pass: addi $7,$7,1
+# ram[11] = 16'b0011101001000000;		// addi $4,$6,-64
+# ram[12] = 16'b0010001010100000;		// movi $5,32
+# ram[13] = 16'b0001011011010000;		// add $5,$5,$5
+# ram[14] = 16'b1001000110000000;		// elem: lw $3,0($4)
+# ram[15] = 16'b0000111110110000;		// add $3,$3,$7
+# ram[16] = 16'b1011000110000000;		// sw $3,0($4)
+# ram[17] = 16'b1011010110000000;		// sw $3,0($5)
+# ram[18] = 16'b0011001000000001;		// addi $4,$4,1
+# ram[19] = 16'b0011011010000001;		// addi $5,$5,1
+# ram[20] = 16'b0001001100100100;		// slt $2,$4,$6
+# ram[21] = 16'b1100100000000001;		// jeq $2,$0,endpass
+# ram[22] = 16'b0100000000001110;		// j elem
+# ram[23] = 16'b1111110100001010;		// endpass: slti $2,$7,10
+# ram[24] = 16'b1100100000000001;		// jeq $2,$0,done
+# ram[25] = 16'b0100000000001010;		// j pass
+# ram[26] = 16'b0100000000011010;		// done: halt 
+#--
+#--
+#--EXECUTION OUTPUT
+# paging.bin --cache 16,1,1 --quiet --final-hash
+# 	Cache L1 has size 16, associativity 1, blocksize 1, rows 16
+# 	Final hash a65dba416face813
+# 
+# paging.bin --cache 16,1,1 --quiet --final-hash --paging 16
+# 	Cache L1 has size 16, associativity 1, blocksize 1, rows 16
+# 	Paging pages 512 of 16 words, page table outside memory, mapping every page to itself
+# 	L1 TLB entries 4, associativity 4, hits 1840, misses 80 (4.17%)
+# 	L2 TLB entries 16, associativity 4, hits 72, misses 8 (10.00%)
+# 	Page walks 8, page faults 0
+# 	  pc:   14 translations 640, walks 4 (0.62%)
+# 	  pc:   17 translations 640, walks 4 (0.62%)
+# 	Final hash a65dba416face813
+# 
+# paging.bin --cache 16,1,1 --quiet --final-hash --paging 1
+# 	Cache L1 has size 16, associativity 1, blocksize 1, rows 16
+# 	Paging pages 8192 of 1 words, page table outside memory, mapping every page to itself
+# 	L1 TLB entries 4, associativity 4, hits 640, misses 1280 (66.67%)
+# 	L2 TLB entries 16, associativity 4, hits 0, misses 1280 (100.00%)
+# 	Page walks 1280, page faults 0
+# 	  pc:   14 translations 640, walks 640 (100.00%)
+# 	  pc:   17 translations 640, walks 640 (100.00%)
+# 	Final hash a65dba416face813
+# 
+# paging.bin --cache 16,1,1 --quiet --final-hash --paging 4096 --tlb 1,1
+# 	Cache L1 has size 16, associativity 1, blocksize 1, rows 16
+# 	Paging pages 2 of 4096 words, page table outside memory, mapping every page to itself
+# 	L1 TLB entries 1, associativity 1, hits 640, misses 1280 (66.67%)
+# 	Page walks 1280, page faults 0
+# 	  pc:   14 translations 640, walks 640 (100.00%)
+# 	  pc:   17 translations 640, walks 640 (100.00%)
+# 	Final hash a65dba416face813
+# 
+# paging.bin --cache 16,1,1 --quiet --final-hash --paging 16 --page-table 4096
+# 	Cache L1 has size 16, associativity 1, blocksize 1, rows 16
+# 	Paging pages 512 of 16 words, page table at 4096
+# 	L1 TLB entries 4, associativity 4, hits 1840, misses 80 (4.17%)
+# 	L2 TLB entries 16, associativity 4, hits 72, misses 8 (10.00%)
+# 	Page walks 8, page faults 8, walk reads served by L1 0, memory 8
+# 	  pc:   14 translations 640, walks 4 (0.62%)
+# 	  pc:   17 translations 640, walks 4 (0.62%)
+# 	Final hash a65dba416face813
+# 
+# paging.bin --cache 16,1,1 --quiet --paging 16 --page-table 8
+# 	Page table at 8 overlaps the program or runs past memory
+# 
@@ -0,0 +1,69 @@
+# A loop of two loads per trip under the 5-stage pipeline of --pipeline. The add
+# after the first load needs its value at once, a load-use stall each trip, while
+# the addi after the second load gives it time. Each taken jeq and j costs branch
+# stall cycles, and the misses add the memory stalls of --timing.
+
+    movi $1, table
+    movi $2, 3              # words left
+loop:
+    lw $3, 0($1)
+    add $4, $4, $3          # uses the load at once: a load-use stall
+    lw $5, 1($1)
+    addi $1, $1, 1          # independent of the load before it
+    add $4, $4, $5
+    addi $2, $2, -1
+    jeq $2, $0, done
+    j loop
+done:
+    halt
+table:
+    .fill 1
+    .fill 2
+    .fill 3
+    .fill 4
+#--
+#--
+#--MACHINE CODE
+# ram[0] = 16'b0010000010001011;		// movi $1,table
+# ram[1] = 16'b0010000100000011;		// movi $2,3
+# ram[2] = 16'b1000010110000000;		// loop: lw $3,0($1)
+# ram[3] = 16'b0001000111000000;		// add $4,$4,$3
+# ram[4] = 16'b1000011010000001;		// lw $5,1($1)
+# ram[5] = 16'b0010010010000001;		// addi $1,$1,1
+# ram[6] = 16'b0001001011000000;		// add $4,$4,$5
+# ram[7] = 16'b0010100101111111;		// addi $2,$2,-1
+# ram[8] = 16'b1100100000000001;		// jeq $2,$0,done
+# ram[9] = 16'b0100000000000010;		// j loop
+# ram[10] = 16'b0100000000001010;		// done: halt 
+# ram[11] = 16'b0000000000000001;		// table: .fill 1
+# ram[12] = 16'b0000000000000010;		// .fill 2
+# ram[13] = 16'b0000000000000011;		// .fill 3
+# ram[14] = 16'b0000000000000100;		// .fill 4
+#--
+#--
+#--EXECUTION OUTPUT
+# pipeline.bin --cache 8,1,2 --quiet --timing 1,10 --pipeline
+# 	Cache L1 has size 8, associativity 1, blocksize 2, rows 4
+# 	Timing: cycles 73, instructions 26, CPI 2.81
+# 	Memory accesses 6, average memory access time 7.00 cycles
+# 	Stall cycles: L1 0, DRAM 36, DRAM queue 0, MSHR 0
+# 	Pipeline: cycles 73, instructions 26, CPI 2.81, stall cycles load-use 3, branch 4, memory 36, fill 4
+# 	  pc:    2 load-use 0, branch 0, memory 12
+# 	  pc:    3 load-use 3, branch 0, memory 0
+# 	  pc:    4 load-use 0, branch 0, memory 24
+# 	  pc:    8 load-use 0, branch 2, memory 0
+# 	  pc:    9 load-use 0, branch 2, memory 0
+# 
+# pipeline.bin --cache 8,1,2,32,2,4 --quiet --timing 1,4,20 --pipeline
+# 	Cache L1 has size 8, associativity 1, blocksize 2, rows 4
+# 	Cache L2 has size 32, associativity 2, blocksize 4, rows 4
+# 	Timing: cycles 97, instructions 26, CPI 3.73
+# 	Memory accesses 6, average memory access time 11.00 cycles
+# 	Stall cycles: L1 0, L2 12, DRAM 48, DRAM queue 0, MSHR 0
+# 	Pipeline: cycles 97, instructions 26, CPI 3.73, stall cycles load-use 3, branch 4, memory 60, fill 4
+# 	  pc:    2 load-use 0, branch 0, memory 28
+# 	  pc:    3 load-use 3, branch 0, memory 0
+# 	  pc:    4 load-use 0, branch 0, memory 32
+# 	  pc:    8 load-use 0, branch 2, memory 0
+# 	  pc:    9 load-use 0, branch 2, memory 0
+# 
@@ -0,0 +1,68 @@
+# Three passes of an inner loop of four calls. The forward jeq of the inner loop
+# is taken once every four trips and that of the outer loop once in three. Without
+# --ras every jr is a mispredicted return, and with --btb the jumps mispredict
+# their targets only when they miss in its four entries.
+
+    movi $5, 3              # outer passes
+outer:
+    movi $1, 4              # inner trips
+inner:
+    jal count
+    addi $1, $1, -1
+    jeq $1, $0, endinner    # taken once every four trips
+    j inner
+endinner:
+    addi $5, $5, -1
+    jeq $5, $0, done
+    j outer
+done:
+    halt
+
+# Counts calls in $6
+count:
+    addi $6, $6, 1
+    jr $7
+#--
+#--
+#--MACHINE CODE
+# ram[0] = 16'b0010001010000011;		// movi $5,3
+# ram[1] = 16'b0010000010000100;		// outer: movi $1,4
+# ram[2] = 16'b0110000000001010;		// inner: jal count
+# ram[3] = 16'b0010010011111111;		// addi $1,$1,-1
+# ram[4] = 16'b1100010000000001;		// jeq $1,$0,endinner
+# ram[5] = 16'b0100000000000010;		// j inner
+# ram[6] = 16'b0011011011111111;		// endinner: addi $5,$5,-1
+# ram[7] = 16'b1101010000000001;		// jeq $5,$0,done
+# ram[8] = 16'b0100000000000001;		// j outer
+# ram[9] = 16'b0100000000001001;		// done: halt 
+# ram[10] = 16'b0011101100000001;		// count: addi $6,$6,1
+# ram[11] = 16'b0001110000001000;		// jr $7
+#--
+#--
+#--EXECUTION OUTPUT
+# predictor.bin --cache 4,1,1 --quiet --predictor static
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	Branch predictor static, counters 1024, BTB 0, RAS 0
+# 	Branches 15 (mispredicted 4, 26.67%), jumps 23 (mispredicted 0), returns 12 (mispredicted 12)
+# 	  pc:    4 executed 12, mispredicted 3 (25.00%)
+# 	  pc:    7 executed 3, mispredicted 1 (33.33%)
+# 	  pc:   11 executed 12, mispredicted 12 (100.00%)
+# 
+# predictor.bin --cache 4,1,1 --quiet --predictor bimodal --predictor-entries 4
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	Branch predictor bimodal, counters 4, BTB 0, RAS 0
+# 	Branches 15 (mispredicted 4, 26.67%), jumps 23 (mispredicted 0), returns 12 (mispredicted 12)
+# 	  pc:    4 executed 12, mispredicted 3 (25.00%)
+# 	  pc:    7 executed 3, mispredicted 1 (33.33%)
+# 	  pc:   11 executed 12, mispredicted 12 (100.00%)
+# 
+# predictor.bin --cache 4,1,1 --quiet --predictor gshare --btb 4 --ras 2
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	Branch predictor gshare, counters 1024, BTB 4, RAS 2
+# 	Branches 15 (mispredicted 4, 26.67%), jumps 23 (mispredicted 4), returns 12 (mispredicted 0)
+# 	  pc:    2 executed 12, mispredicted 1 (8.33%)
+# 	  pc:    4 executed 12, mispredicted 3 (25.00%)
+# 	  pc:    5 executed 9, mispredicted 1 (11.11%)
+# 	  pc:    7 executed 3, mispredicted 1 (33.33%)
+# 	  pc:    8 executed 2, mispredicted 2 (100.00%)
+# 
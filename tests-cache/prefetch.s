@@ -0,0 +1,86 @@
+# Prefetchers fetch blocks ahead of the loads, logged as PF. The loop loads every
+# other word from 40 up to 48, one 2-word block after another, all from one pc.
+
+movi $1, 40
+movi $2, 48
+loop:
+lw $3, 0($1)
+addi $1, $1, 2
+jeq $1, $2, done
+j loop
+done:
+halt
+#--
+#--
+#--MACHINE CODE
+# ram[0] = 16'b0010000010101000;		// movi $1,40
+# ram[1] = 16'b0010000100110000;		// movi $2,48
+# ram[2] = 16'b1000010110000000;		// loop: lw $3,0($1)
+# ram[3] = 16'b0010010010000010;		// addi $1,$1,2
+# ram[4] = 16'b1100010100000001;		// jeq $1,$2,done
+# ram[5] = 16'b0100000000000010;		// j loop
+# ram[6] = 16'b0100000000000110;		// done: halt 
+#--
+#--
+#--EXECUTION OUTPUT
+# prefetch.bin --cache 16,1,2 --prefetch nextline
+# 	Cache L1 has size 16, associativity 1, blocksize 2, rows 8
+# 	L1 MISS  pc:    2	addr:   40	row:   4
+# 	L1 PF    pc:    2	addr:   42	row:   5
+# 	L1 HIT   pc:    2	addr:   42	row:   5
+# 	L1 PF    pc:    2	addr:   44	row:   6
+# 	L1 HIT   pc:    2	addr:   44	row:   6
+# 	L1 PF    pc:    2	addr:   46	row:   7
+# 	L1 HIT   pc:    2	addr:   46	row:   7
+# 	L1 PF    pc:    2	addr:   48	row:   0
+# 	Prefetch L1 nextline: issued 4, useful 3, useless 0, dropped 0, accuracy 75.00%, coverage 75.00%, misses avoided 3
+# 
+# prefetch.bin --cache 16,1,2 --prefetch nextline --prefetch-degree 2
+# 	Cache L1 has size 16, associativity 1, blocksize 2, rows 8
+# 	L1 MISS  pc:    2	addr:   40	row:   4
+# 	L1 PF    pc:    2	addr:   42	row:   5
+# 	L1 PF    pc:    2	addr:   44	row:   6
+# 	L1 HIT   pc:    2	addr:   42	row:   5
+# 	L1 PF    pc:    2	addr:   46	row:   7
+# 	L1 HIT   pc:    2	addr:   44	row:   6
+# 	L1 PF    pc:    2	addr:   48	row:   0
+# 	L1 HIT   pc:    2	addr:   46	row:   7
+# 	L1 PF    pc:    2	addr:   50	row:   1
+# 	Prefetch L1 nextline: issued 5, useful 3, useless 0, dropped 0, accuracy 60.00%, coverage 75.00%, misses avoided 3
+# 
+# prefetch.bin --cache 16,1,2 --prefetch stride
+# 	Cache L1 has size 16, associativity 1, blocksize 2, rows 8
+# 	L1 MISS  pc:    2	addr:   40	row:   4
+# 	L1 MISS  pc:    2	addr:   42	row:   5
+# 	L1 MISS  pc:    2	addr:   44	row:   6
+# 	L1 MISS  pc:    2	addr:   46	row:   7
+# 	L1 PF    pc:    2	addr:   48	row:   0
+# 	Prefetch L1 stride: issued 1, useful 0, useless 0, dropped 0, accuracy 0.00%, coverage 0.00%, misses avoided 0
+# 
+# prefetch.bin --cache 16,1,2 --prefetch stream
+# 	Cache L1 has size 16, associativity 1, blocksize 2, rows 8
+# 	L1 MISS  pc:    2	addr:   40	row:   4
+# 	L1 MISS  pc:    2	addr:   42	row:   5
+# 	L1 MISS  pc:    2	addr:   44	row:   6
+# 	L1 PF    pc:    2	addr:   46	row:   7
+# 	L1 HIT   pc:    2	addr:   46	row:   7
+# 	L1 PF    pc:    2	addr:   48	row:   0
+# 	Prefetch L1 stream: issued 2, useful 1, useless 0, dropped 0, accuracy 50.00%, coverage 25.00%, misses avoided 1
+# 
+# prefetch.bin --cache 16,1,2,32,2,2 --prefetch none,nextline
+# 	Cache L1 has size 16, associativity 1, blocksize 2, rows 8
+# 	Cache L2 has size 32, associativity 2, blocksize 2, rows 8
+# 	L1 MISS  pc:    2	addr:   40	row:   4
+# 	L2 MISS  pc:    2	addr:   40	row:   4
+# 	L2 PF    pc:    2	addr:   42	row:   5
+# 	L1 MISS  pc:    2	addr:   42	row:   5
+# 	L2 HIT   pc:    2	addr:   42	row:   5
+# 	L2 PF    pc:    2	addr:   44	row:   6
+# 	L1 MISS  pc:    2	addr:   44	row:   6
+# 	L2 HIT   pc:    2	addr:   44	row:   6
+# 	L2 PF    pc:    2	addr:   46	row:   7
+# 	L1 MISS  pc:    2	addr:   46	row:   7
+# 	L2 HIT   pc:    2	addr:   46	row:   7
+# 	L2 PF    pc:    2	addr:   48	row:   0
+# 	Prefetch L2 nextline: issued 4, useful 3, useless 0, dropped 0, accuracy 75.00%, coverage 75.00%, misses avoided 3
+# 
@@ -0,0 +1,45 @@
+# Runs of a short program with the result cache, each in an empty $tmp. Without
+# --result-cache nothing is written, even with XDG_CACHE_HOME and HOME set. With it
+# the first run keeps its output in $XDG_CACHE_HOME/simcache and the second replays
+# the same output. A run that prints the log is only kept with --result-cache-log,
+# and --no-result-cache turns a --result-cache-dir given before it off again.
+
+    movi $1, 9
+    sw $1, 12($0)
+    lw $2, 12($0)
+    lw $3, 16($0)   # evicts 12
+    lw $4, 12($0)
+    halt
+#--
+#--
+#--MACHINE CODE
+# ram[0] = 16'b0010000010001001;		// movi $1,9
+# ram[1] = 16'b1010000010001100;		// sw $1,12($0)
+# ram[2] = 16'b1000000100001100;		// lw $2,12($0)
+# ram[3] = 16'b1000000110010000;		// lw $3,16($0)
+# ram[4] = 16'b1000001000001100;		// lw $4,12($0)
+# ram[5] = 16'b0100000000000101;		// halt 
+#--
+#--
+#--EXECUTION OUTPUT
+# $ HOME=$tmp XDG_CACHE_HOME=$tmp/xdg ./simcache.exe --cache 4,1,1 --quiet --stats tests-cache/resultcache.bin && ls $tmp
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	Cache L1 reads 3 (hits 1, misses 2), writes 1 (hits 0, misses 1), writebacks 0
+# 	Memory words read 3, words written 1
+# 
+# $ export XDG_CACHE_HOME=$tmp; for run in 1 2; do ./simcache.exe --result-cache --cache 4,1,1 --quiet --stats tests-cache/resultcache.bin; done; ls $tmp/simcache | wc -l
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	Cache L1 reads 3 (hits 1, misses 2), writes 1 (hits 0, misses 1), writebacks 0
+# 	Memory words read 3, words written 1
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	Cache L1 reads 3 (hits 1, misses 2), writes 1 (hits 0, misses 1), writebacks 0
+# 	Memory words read 3, words written 1
+# 	1
+# 
+# $ for log in "" --result-cache-log; do ./simcache.exe --result-cache-dir $tmp/rc $log --cache 4,1,1 tests-cache/resultcache.bin > /dev/null; ls $tmp/rc 2> /dev/null | wc -l; done
+# 	0
+# 	1
+# 
+# $ ./simcache.exe --result-cache-dir $tmp/rc --no-result-cache --cache 4,1,1 --quiet tests-cache/resultcache.bin > /dev/null; ls $tmp/rc 2> /dev/null | wc -l
+# 	0
+# 
@@ -0,0 +1,83 @@
+# Three passes over four words, loading each and storing it ten words on. Each of
+# the eight words is touched once a pass, so after the cold first pass every reuse
+# distance is seven and each window of eight accesses holds all eight words. With
+# two-word blocks neighbouring words share a block and the distances shrink. The
+# profiles go to a file, as CSV or, for a name ending in .json, as JSON.
+
+    movi $2, 3              # passes
+pass:
+    movi $1, 0
+elem:
+    lw $3, 40($1)           # stride 1 over four words
+    sw $3, 50($1)
+    addi $1, $1, 1
+    slti $4, $1, 4
+    jeq $4, $0, endpass
+    j elem
+endpass:
+    addi $2, $2, -1
+    jeq $2, $0, done
+    j pass
+done:
+    halt
+#--
+#--
+#--MACHINE CODE
+# ram[0] = 16'b0010000100000011;		// movi $2,3
+# ram[1] = 16'b0010000010000000;		// pass: movi $1,0
+# ram[2] = 16'b1000010110101000;		// elem: lw $3,40($1)
+# ram[3] = 16'b1010010110110010;		// sw $3,50($1)
+# ram[4] = 16'b0010010010000001;		// addi $1,$1,1
+# ram[5] = 16'b1110011000000100;		// slti $4,$1,4
+# ram[6] = 16'b1101000000000001;		// jeq $4,$0,endpass
+# ram[7] = 16'b0100000000000010;		// j elem
+# ram[8] = 16'b0010100101111111;		// endpass: addi $2,$2,-1
+# ram[9] = 16'b1100100000000001;		// jeq $2,$0,done
+# ram[10] = 16'b0100000000000001;		// j pass
+# ram[11] = 16'b0100000000001011;		// done: halt 
+#--
+#--
+#--EXECUTION OUTPUT
+# $ ./simcache.exe --cache 4,1,1 --quiet --reuse-profile $tmp/reuse.csv --reuse-window 8 tests-cache/reuse.bin && cat $tmp/reuse.csv
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	section,key,value,accesses,matches
+# 	reuse,0-0,0,,
+# 	reuse,1-1,0,,
+# 	reuse,2-3,0,,
+# 	reuse,4-7,16,,
+# 	reuse,8-15,0,,
+# 	reuse,16-31,0,,
+# 	reuse,32-63,0,,
+# 	reuse,64-127,0,,
+# 	reuse,128-255,0,,
+# 	reuse,256-511,0,,
+# 	reuse,512-1023,0,,
+# 	reuse,1024-2047,0,,
+# 	reuse,2048-4095,0,,
+# 	reuse,4096-8191,0,,
+# 	reuse,cold,8,,
+# 	working_set,8,8,,
+# 	working_set,16,8,,
+# 	working_set,24,8,,
+# 	stride,2,1,12,6
+# 	stride,3,1,12,6
+# 
+# $ ./simcache.exe --cache 4,1,1 --quiet --reuse-profile $tmp/reuse.json --reuse-block 2 --reuse-window 8 tests-cache/reuse.bin && cat $tmp/reuse.json
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	{
+# 	  "block_size": 2,
+# 	  "accesses": 24,
+# 	  "reuse": {
+# 	    "cold": 4,
+# 	    "buckets": [{"min": 0, "max": 0, "count": 0}, {"min": 1, "max": 1, "count": 12}, {"min": 2, "max": 3, "count": 8}, {"min": 4, "max": 7, "count": 0}, {"min": 8, "max": 15, "count": 0}, {"min": 16, "max": 31, "count": 0}, {"min": 32, "max": 63, "count": 0}, {"min": 64, "max": 127, "count": 0}, {"min": 128, "max": 255, "count": 0}, {"min": 256, "max": 511, "count": 0}, {"min": 512, "max": 1023, "count": 0}, {"min": 1024, "max": 2047, "count": 0}, {"min": 2048, "max": 4095, "count": 0}, {"min": 4096, "max": 8191, "count": 0}]
+# 	  },
+# 	  "working_set": {
+# 	    "window": 8,
+# 	    "samples": [4, 4, 4]
+# 	  },
+# 	  "strides": [
+# 	    {"pc": 2, "stride": 1, "accesses": 12, "matches": 6},
+# 	    {"pc": 3, "stride": 1, "accesses": 12, "matches": 6}
+# 	  ]
+# 	}
+# 
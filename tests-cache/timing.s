@@ -0,0 +1,83 @@
+# Sums the four words of a table twice. The first pass misses in L1 and L2, so
+# --timing stalls it for L2 and DRAM, and the second pass only hits in L1. The
+# cycles are the instructions plus the stall cycles, which --dram-bw lengthens.
+
+    movi $5, 2              # passes
+pass:
+    movi $1, table
+    movi $2, 4              # words left
+elem:
+    lw $3, 0($1)
+    add $4, $4, $3
+    addi $1, $1, 1
+    addi $2, $2, -1
+    jeq $2, $0, endpass
+    j elem
+endpass:
+    addi $5, $5, -1
+    jeq $5, $0, done
+    j pass
+done:
+    sw $4, sum($0)
+    halt
+table:
+    .fill 1
+    .fill 2
+    .fill 3
+    .fill 4
+sum:
+    .fill 0
+#--
+#--
+#--MACHINE CODE
+# ram[0] = 16'b0010001010000010;		// movi $5,2
+# ram[1] = 16'b0010000010001110;		// pass: movi $1,table
+# ram[2] = 16'b0010000100000100;		// movi $2,4
+# ram[3] = 16'b1000010110000000;		// elem: lw $3,0($1)
+# ram[4] = 16'b0001000111000000;		// add $4,$4,$3
+# ram[5] = 16'b0010010010000001;		// addi $1,$1,1
+# ram[6] = 16'b0010100101111111;		// addi $2,$2,-1
+# ram[7] = 16'b1100100000000001;		// jeq $2,$0,endpass
+# ram[8] = 16'b0100000000000011;		// j elem
+# ram[9] = 16'b0011011011111111;		// endpass: addi $5,$5,-1
+# ram[10] = 16'b1101010000000001;		// jeq $5,$0,done
+# ram[11] = 16'b0100000000000001;		// j pass
+# ram[12] = 16'b1010001000010010;		// done: sw $4,sum($0)
+# ram[13] = 16'b0100000000001101;		// halt 
+# ram[14] = 16'b0000000000000001;		// table: .fill 1
+# ram[15] = 16'b0000000000000010;		// .fill 2
+# ram[16] = 16'b0000000000000011;		// .fill 3
+# ram[17] = 16'b0000000000000100;		// .fill 4
+# ram[18] = 16'b0000000000000000;		// sum: .fill 0
+#--
+#--
+#--EXECUTION OUTPUT
+# timing.bin --cache 8,1,2,32,2,4 --timing 1,5,50
+# 	Cache L1 has size 8, associativity 1, blocksize 2, rows 4
+# 	Cache L2 has size 32, associativity 2, blocksize 4, rows 4
+# 	L1 MISS  pc:    3	addr:   14	row:   3
+# 	L2 MISS  pc:    3	addr:   14	row:   3
+# 	L1 HIT   pc:    3	addr:   15	row:   3
+# 	L1 MISS  pc:    3	addr:   16	row:   0
+# 	L2 MISS  pc:    3	addr:   16	row:   0
+# 	L1 HIT   pc:    3	addr:   17	row:   0
+# 	L1 HIT   pc:    3	addr:   14	row:   3
+# 	L1 HIT   pc:    3	addr:   15	row:   3
+# 	L1 HIT   pc:    3	addr:   16	row:   0
+# 	L1 HIT   pc:    3	addr:   17	row:   0
+# 	L1 SW    pc:   12	addr:   18	row:   1
+# 	L2 SW    pc:   12	addr:   18	row:   0
+# 	Timing: cycles 176, instructions 58, CPI 3.03
+# 	Memory accesses 9, average memory access time 14.11 cycles
+# 	Stall cycles: L1 0, L2 10, DRAM 108, DRAM queue 0, MSHR 0
+# 
+# timing.bin --cache 8,1,2,32,2,4 --timing 1,5,50 --dram-bw 4 --quiet --stats
+# 	Cache L1 has size 8, associativity 1, blocksize 2, rows 4
+# 	Cache L2 has size 32, associativity 2, blocksize 4, rows 4
+# 	Cache L1 reads 8 (hits 6, misses 2), writes 1 (hits 0, misses 1), writebacks 0
+# 	Cache L2 reads 2 (hits 0, misses 2), writes 1 (hits 1, misses 0), writebacks 0
+# 	Memory words read 8, words written 1
+# 	Timing: cycles 200, instructions 58, CPI 3.45
+# 	Memory accesses 9, average memory access time 16.78 cycles
+# 	Stall cycles: L1 0, L2 10, DRAM 132, DRAM queue 0, MSHR 0
+# 
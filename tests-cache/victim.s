@@ -0,0 +1,80 @@
+# A victim cache behind L1, named VC, catches the blocks L1 evicts. Addresses 10
+# and 14 share a row of a 4-row L1, so without it every load misses.
+
+movi $1, 5
+lw $2, 10($0)
+lw $2, 14($0)   # evicts 10 into the victim cache
+lw $2, 10($0)   # found in the victim cache and swapped back
+sw $1, 14($0)
+lw $2, 10($0)
+lw $2, 18($0)   # pushes 14 out of a 1-entry victim cache
+halt
+#--
+#--
+#--MACHINE CODE
+# ram[0] = 16'b0010000010000101;		// movi $1,5
+# ram[1] = 16'b1000000100001010;		// lw $2,10($0)
+# ram[2] = 16'b1000000100001110;		// lw $2,14($0)
+# ram[3] = 16'b1000000100001010;		// lw $2,10($0)
+# ram[4] = 16'b1010000010001110;		// sw $1,14($0)
+# ram[5] = 16'b1000000100001010;		// lw $2,10($0)
+# ram[6] = 16'b1000000100010010;		// lw $2,18($0)
+# ram[7] = 16'b0100000000000111;		// halt 
+#--
+#--
+#--EXECUTION OUTPUT
+# victim.bin --cache 4,1,1
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	L1 MISS  pc:    1	addr:   10	row:   2
+# 	L1 MISS  pc:    2	addr:   14	row:   2
+# 	L1 MISS  pc:    3	addr:   10	row:   2
+# 	L1 SW    pc:    4	addr:   14	row:   2
+# 	L1 MISS  pc:    5	addr:   10	row:   2
+# 	L1 MISS  pc:    6	addr:   18	row:   2
+# 
+# victim.bin --cache 4,1,1 --victim 1
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	L1 MISS  pc:    1	addr:   10	row:   2
+# 	VC MISS  pc:    1	addr:   10	row:   0
+# 	L1 MISS  pc:    2	addr:   14	row:   2
+# 	VC MISS  pc:    2	addr:   14	row:   0
+# 	L1 MISS  pc:    3	addr:   10	row:   2
+# 	VC HIT   pc:    3	addr:   10	row:   0
+# 	L1 SW    pc:    4	addr:   14	row:   2
+# 	L1 MISS  pc:    5	addr:   10	row:   2
+# 	VC HIT   pc:    5	addr:   10	row:   0
+# 	L1 MISS  pc:    6	addr:   18	row:   2
+# 	VC MISS  pc:    6	addr:   18	row:   0
+# 
+# victim.bin --cache 4,1,1 --victim 1 --write-policy wb
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	L1 MISS  pc:    1	addr:   10	row:   2
+# 	VC MISS  pc:    1	addr:   10	row:   0
+# 	L1 MISS  pc:    2	addr:   14	row:   2
+# 	VC MISS  pc:    2	addr:   14	row:   0
+# 	L1 MISS  pc:    3	addr:   10	row:   2
+# 	VC HIT   pc:    3	addr:   10	row:   0
+# 	L1 SW    pc:    4	addr:   14	row:   2
+# 	L1 MISS  pc:    5	addr:   10	row:   2
+# 	VC HIT   pc:    5	addr:   10	row:   0
+# 	L1 MISS  pc:    6	addr:   18	row:   2
+# 	VC MISS  pc:    6	addr:   18	row:   0
+# 	VC WB    pc:    6	addr:   14	row:   0
+# 
+# victim.bin --cache 4,1,1 --victim 2 --stats
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	L1 MISS  pc:    1	addr:   10	row:   2
+# 	VC MISS  pc:    1	addr:   10	row:   0
+# 	L1 MISS  pc:    2	addr:   14	row:   2
+# 	VC MISS  pc:    2	addr:   14	row:   0
+# 	L1 MISS  pc:    3	addr:   10	row:   2
+# 	VC HIT   pc:    3	addr:   10	row:   0
+# 	L1 SW    pc:    4	addr:   14	row:   2
+# 	L1 MISS  pc:    5	addr:   10	row:   2
+# 	VC HIT   pc:    5	addr:   10	row:   0
+# 	L1 MISS  pc:    6	addr:   18	row:   2
+# 	VC MISS  pc:    6	addr:   18	row:   0
+# 	Cache L1 reads 5 (hits 0, misses 5), writes 1 (hits 0, misses 1), writebacks 0
+# 	Victim cache entries 2, hits 2, misses 3
+# 	Memory words read 3, words written 1
+# 
@@ -0,0 +1,55 @@
+# Write-back caches mark written blocks dirty and write them back, logged as WB,
+# only when they are evicted. Addresses 10 and 14 share a row of a 4-row cache.
+# Without write-allocate a write miss goes around the cache.
+
+movi $1, 5
+sw $1, 10($0)   # allocates 10, dirty
+lw $2, 14($0)   # evicts dirty 10
+sw $1, 14($0)   # a hit, which makes 14 dirty
+lw $3, 10($0)   # evicts dirty 14
+halt
+#--
+#--
+#--MACHINE CODE
+# ram[0] = 16'b0010000010000101;		// movi $1,5
+# ram[1] = 16'b1010000010001010;		// sw $1,10($0)
+# ram[2] = 16'b1000000100001110;		// lw $2,14($0)
+# ram[3] = 16'b1010000010001110;		// sw $1,14($0)
+# ram[4] = 16'b1000000110001010;		// lw $3,10($0)
+# ram[5] = 16'b0100000000000101;		// halt 
+#--
+#--
+#--EXECUTION OUTPUT
+# writeback.bin --cache 4,1,1 --write-policy wb
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	L1 SW    pc:    1	addr:   10	row:   2
+# 	L1 MISS  pc:    2	addr:   14	row:   2
+# 	L1 WB    pc:    2	addr:   10	row:   2
+# 	L1 SW    pc:    3	addr:   14	row:   2
+# 	L1 MISS  pc:    4	addr:   10	row:   2
+# 	L1 WB    pc:    4	addr:   14	row:   2
+# 
+# writeback.bin --cache 4,1,1,16,2,1 --write-policy wb
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	Cache L2 has size 16, associativity 2, blocksize 1, rows 8
+# 	L1 SW    pc:    1	addr:   10	row:   2
+# 	L1 MISS  pc:    2	addr:   14	row:   2
+# 	L2 MISS  pc:    2	addr:   14	row:   6
+# 	L1 WB    pc:    2	addr:   10	row:   2
+# 	L1 SW    pc:    3	addr:   14	row:   2
+# 	L1 MISS  pc:    4	addr:   10	row:   2
+# 	L2 HIT   pc:    4	addr:   10	row:   2
+# 	L1 WB    pc:    4	addr:   14	row:   2
+# 
+# writeback.bin --cache 4,1,1 --write-policy wb --write-alloc noalloc
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	L1 MISS  pc:    2	addr:   14	row:   2
+# 	L1 SW    pc:    3	addr:   14	row:   2
+# 	L1 MISS  pc:    4	addr:   10	row:   2
+# 	L1 WB    pc:    4	addr:   14	row:   2
+# 
+# writeback.bin --cache 4,1,1 --write-policy wb --quiet --stats
+# 	Cache L1 has size 4, associativity 1, blocksize 1, rows 4
+# 	Cache L1 reads 2 (hits 0, misses 2), writes 2 (hits 1, misses 1), writebacks 2
+# 	Memory words read 3, words written 2
+# 